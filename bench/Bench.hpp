@@ -0,0 +1,122 @@
+#ifndef TOYLANG_BENCH_HPP
+#define TOYLANG_BENCH_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A deliberately small benchmark harness: each BENCH registers a function
+// that times its own work with Bench::measure and prints figures through
+// Bench::report. Run ToyLangBench [filter] to select benchmarks by name.
+class Bench {
+  public:
+    using Function = void (*)();
+
+    struct Entry {
+        const char *name;
+        Function function;
+    };
+
+    static std::vector<Entry> &registry() {
+        static std::vector<Entry> entries;
+        return entries;
+    }
+
+    struct Registrar {
+        Registrar(const char *name, Function function) {
+            registry().push_back({name, function});
+        }
+    };
+
+    // Best wall-clock time in seconds over `repeat` runs of work.
+    static double measure(const std::function<void()> &work, int repeat = 3) {
+        double best = 1e300;
+        for (int i = 0; i < repeat; i++) {
+            auto begin = std::chrono::steady_clock::now();
+            work();
+            auto end = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(end - begin).count();
+            if (seconds < best)
+                best = seconds;
+        }
+        return best;
+    }
+
+    // Heap allocations made so far by the whole process.
+    static std::size_t allocations() { return allocationCount.load(); }
+    static std::atomic<std::size_t> allocationCount;
+
+    static void report(const std::string &label, double value,
+                       const char *unit) {
+        std::printf("  %-36s %14.3f %s\n", label.c_str(), value, unit);
+    }
+
+    static void report(const std::string &label, std::size_t value,
+                       const char *unit) {
+        std::printf("  %-36s %14zu %s\n", label.c_str(), value, unit);
+    }
+
+    static void note(const std::string &label, const std::string &text) {
+        std::printf("  %-36s %14s\n", label.c_str(), text.c_str());
+    }
+
+    // Deterministic, machine-generated looking ToyLang source of roughly
+    // `bytes` bytes: long expression statements over numbers, identifiers,
+    // strings and keywords, with trailing and block comments sprinkled in.
+    static std::string generateSource(std::size_t bytes) {
+        std::string out;
+        out.reserve(bytes + 256);
+        unsigned state = 12345;
+        auto next = [&state](unsigned bound) {
+            state = state * 1103515245u + 12345u;
+            return (state >> 8) % bound;
+        };
+
+        while (out.size() < bytes) {
+            if (next(20) == 0)
+                out += "/* generated block\n   comment */\n";
+            out += "        ";
+            for (int i = 0; i < 8; i++) {
+                if (i > 0)
+                    out += " + ";
+                switch (next(8)) {
+                case 0:
+                case 1:
+                    out += std::to_string(next(100000)) + "." +
+                           std::to_string(next(1000));
+                    break;
+                case 2:
+                case 3:
+                    out += "var_" + std::to_string(next(100000));
+                    break;
+                case 4:
+                    out += next(2) ? "true" : "null";
+                    break;
+                case 5:
+                    out += "\"generated string " + std::to_string(next(10000)) +
+                           "\"";
+                    break;
+                default:
+                    out += "(" + std::to_string(next(100)) + " * 2)";
+                    break;
+                }
+            }
+            out += ";";
+            if (next(5) == 0)
+                out += "  // trailing comment with a few words";
+            out += "\n";
+        }
+        return out;
+    }
+};
+
+#define BENCH(group, name)                                                     \
+    static void bench_##group##_##name();                                      \
+    static Bench::Registrar registrar_##group##_##name(#group "." #name,       \
+                                                       bench_##group##_##name); \
+    static void bench_##group##_##name()
+
+#endif
@@ -0,0 +1,108 @@
+#include "Bench.hpp"
+
+#include "CompileCache.hpp"
+#include "Compiler.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "Session.hpp"
+#include "ThreadPool.hpp"
+#include "TypeChecker.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+// Cost of each -O level on a module of many small functions.
+BENCH(Compiler, OptimizationLevels) {
+    std::string source;
+    for (unsigned i = 0; i < 2000; i++)
+        source += std::to_string(i) + ".5 * 2 + 1 < 3 - 4 / " +
+                  std::to_string(i + 1) + ";\n";
+
+    Lexer lexer(source);
+    Arena arena;
+    Parser parser(lexer, arena);
+    std::vector<const Expr *> statements = parser.parse();
+    std::vector<ValueType> types;
+    ExprTypes inferred;
+    TypeChecker checker(lexer);
+    for (const Expr *statement : statements)
+        types.push_back(checker.check(statement, inferred));
+
+    for (unsigned level = 0; level <= 3; level++) {
+        Compiler compiler(lexer);
+        for (std::size_t i = 0; i < statements.size(); i++) {
+            compiler.begin();
+            compiler.finish("f" + std::to_string(i), types[i],
+                            compiler.codegen(statements[i], inferred));
+        }
+
+        double seconds =
+            Bench::measure([&] { compiler.optimize(level); }, 1);
+
+        Bench::report("-O" + std::to_string(level), seconds * 1e3, "ms");
+    }
+}
+
+// Many scripts of uneven size compiled one after another versus as tasks of
+// a work-stealing pool, one Session each.
+BENCH(Compiler, ParallelSessions) {
+    std::vector<std::string> sources;
+    for (unsigned i = 0; i < 64; i++) {
+        std::string source;
+        for (unsigned j = 0; j < 50 * (i % 8 + 1); j++)
+            source += std::to_string(j) + " * 2 + " + std::to_string(i) +
+                      " < 3;\n";
+        sources.push_back(std::move(source));
+    }
+
+    Options options;
+    options.optLevel = 2;
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned threads : {1u, hardware}) {
+        double seconds = Bench::measure(
+            [&] {
+                std::vector<std::unique_ptr<Session>> sessions;
+                for (std::size_t i = 0; i < sources.size(); i++)
+                    sessions.push_back(std::make_unique<Session>(
+                        sources[i], options, "f" + std::to_string(i)));
+
+                ThreadPool pool(threads);
+                for (auto &session : sessions)
+                    pool.submit([&session] { session->compile(); });
+                pool.wait();
+            },
+            1);
+
+        Bench::report("-j" + std::to_string(threads), seconds * 1e3, "ms");
+    }
+}
+
+// A cold compile that fills the cache versus a warm one served from it.
+BENCH(Compiler, CacheWarmStart) {
+    std::string source;
+    for (unsigned i = 0; i < 2000; i++)
+        source += std::to_string(i) + ".5 * 2 + 1 < 3 - 4 / " +
+                  std::to_string(i + 1) + ";\n";
+
+    std::string directory =
+        (std::filesystem::temp_directory_path() / "toylang-bench").string();
+    std::filesystem::remove_all(directory);
+    CompileCache cache(directory, std::uint64_t(64) << 20);
+
+    Options options;
+    options.optLevel = 2;
+    for (const char *start : {"cold", "warm"}) {
+        double seconds = Bench::measure(
+            [&] {
+                Session session(source, options, "f");
+                session.compile(nullptr, &cache);
+            },
+            1);
+        Bench::report(start, seconds * 1e3, "ms");
+    }
+    Bench::report("hits", cache.hits(), "");
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,63 @@
+#include "Bench.hpp"
+
+#include "ByteScanner.hpp"
+#include "Lexer.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+BENCH(Lexer, MachineGenerated) {
+    const std::string source = Bench::generateSource(64 << 20);
+
+    std::size_t count = 0;
+    double seconds = Bench::measure([&] {
+        Lexer lexer(source);
+        count = lexer.scanTokens().size();
+    });
+
+    Bench::note("isa", ByteScanner::isa());
+    Bench::report("tokens", count, "");
+    Bench::report("lex rate", source.size() / seconds / 1e6, "MB/s");
+}
+
+BENCH(Lexer, TokenFootprint) {
+    const std::string source = Bench::generateSource(16 << 20);
+
+    std::size_t count = 0;
+    std::size_t before = Bench::allocations();
+    double seconds = Bench::measure(
+        [&] {
+            Lexer lexer(source);
+            while (lexer.next().type != TokenType::END_OF_FILE)
+                count++;
+        },
+        1);
+    std::size_t allocations = Bench::allocations() - before;
+
+    Bench::report("bytes per token", sizeof(Token), "B");
+    Bench::report("tokens", count, "");
+    Bench::report("allocations while lexing", allocations, "");
+    Bench::report("streaming lex rate", source.size() / seconds / 1e6,
+                  "MB/s");
+}
+
+BENCH(Lexer, ParallelChunks) {
+    const std::string source = Bench::generateSource(128 << 20);
+
+    double serial = Bench::measure([&] {
+        Lexer lexer(source);
+        lexer.scanTokens();
+    });
+    Bench::report("serial", source.size() / serial / 1e6, "MB/s");
+
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= hardware; threads *= 2) {
+        ThreadPool pool(threads);
+        double seconds = Bench::measure([&] {
+            Lexer lexer(source);
+            lexer.scanTokens(pool);
+        });
+        Bench::report(std::to_string(threads) + " threads",
+                      source.size() / seconds / 1e6, "MB/s");
+    }
+}
@@ -0,0 +1,258 @@
+#include "Bench.hpp"
+
+#include <algorithm>
+
+#include "Compiler.hpp"
+#include "ConstantFolder.hpp"
+#include "FlatAST.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "Rebalancer.hpp"
+#include "TypeChecker.hpp"
+
+// One long left-associative chain: `1.5 + 2.5 * 3.5 - 4.5 ...`.
+static std::string generateChain(std::size_t bytes) {
+    static const char *ops[] = {" + ", " * ", " - ", " / "};
+    std::string out = "0.5";
+    for (unsigned i = 1; out.size() < bytes; i++) {
+        out += ops[i % 4];
+        out += std::to_string(i % 1000) + ".5";
+    }
+    return out;
+}
+
+BENCH(Parser, StreamingChain) {
+    const std::string source = generateChain(1 << 20);
+
+    double seconds = Bench::measure([&] {
+        Lexer lexer(source);
+        Arena arena;
+        Parser parser(lexer, arena);
+        parser.parse();
+    });
+
+    Bench::report("lex+parse+free rate", source.size() / seconds / 1e6,
+                  "MB/s");
+}
+
+BENCH(Parser, MillionNodeArena) {
+    const std::string source = generateChain(6 << 20);
+
+    std::size_t allocations = 0;
+    double parse = 0, teardown = 0;
+    Bench::measure(
+        [&] {
+            Lexer lexer(source);
+            auto arena = std::make_unique<Arena>();
+            std::size_t before = Bench::allocations();
+            parse = Bench::measure(
+                [&] {
+                    Parser parser(lexer, *arena);
+                    parser.parse();
+                },
+                1);
+            allocations = Bench::allocations() - before;
+            teardown = Bench::measure([&] { arena.reset(); }, 1);
+        },
+        1);
+
+    Bench::report("parse", parse * 1e3, "ms");
+    Bench::report("free", teardown * 1e3, "ms");
+    Bench::report("allocations", allocations, "");
+}
+
+// Parenthesized groups of 64 terms chained together.
+static std::string generateGroups(std::size_t bytes) {
+    std::string out;
+    for (unsigned group = 0; out.size() < bytes; group++) {
+        if (group > 0)
+            out += " * ";
+        out += "(";
+        for (unsigned term = 0; term < 64; term++) {
+            if (term > 0)
+                out += term % 2 ? " + " : " - ";
+            out += std::to_string(term) + ".5";
+        }
+        out += ")";
+    }
+    return out;
+}
+
+BENCH(Parser, FlatVersusTree) {
+    const std::string source = generateGroups(8 << 20);
+
+    Lexer lexer(source);
+    Arena arena;
+    Parser parser(lexer, arena);
+    const Expr *expr = parser.parse().front();
+    FlatAST ast = FlatAST::flatten(expr);
+
+    Bench::report("nodes", std::size_t(ast.size()), "");
+    Bench::report("tree bytes per node", double(arena.capacity()) / ast.size(),
+                  "B");
+    Bench::report("flat bytes per node", double(ast.bytes()) / ast.size(),
+                  "B");
+
+    // The same pass both ways: sum every number literal.
+    struct Summer : ExprVisitor<double> {
+        const LiteralTable &literals;
+        Summer(const LiteralTable &literals) : literals(literals) {}
+
+        double visit(const BinaryExpr &, double left, double right) override {
+            return left + right;
+        }
+        double visit(const DeclarationExpr &, double initializer) override {
+            return initializer;
+        }
+        double visit(const GroupingExpr &, double expression) override {
+            return expression;
+        }
+        double visit(const LiteralExpr &expr) override {
+            return literals.number(expr.value);
+        }
+        double visit(const UnaryExpr &, double right) override {
+            return right;
+        }
+        double visit(const VariableExpr &) override { return 0; }
+    };
+
+    double treeSum = 0, flatSum = 0;
+    double tree = Bench::measure([&] {
+        Summer summer(lexer.literals());
+        treeSum = expr->accept(summer);
+    });
+
+    double flat = Bench::measure([&] {
+        flatSum = 0;
+        for (FlatAST::Index node = 0; node < ast.size(); node++) {
+            switch (ast.kind(node)) {
+            case ExprKind::Literal:
+                flatSum += lexer.literals().number(ast.token(node));
+                break;
+            default:
+                break;
+            }
+        }
+    });
+
+    Bench::report("tree walk", tree * 1e3, "ms");
+    Bench::report("flat walk", flat * 1e3, "ms");
+    Bench::report("sums agree", std::size_t(treeSum == flatSum), "");
+}
+
+BENCH(Parser, RebalanceMillionTerms) {
+    std::string source = "0.5";
+    for (unsigned i = 1; i < 1000000; i++)
+        source += " + " + std::to_string(i % 1000) + ".5";
+
+    struct Depth : ExprVisitor<std::size_t> {
+        std::size_t visit(const BinaryExpr &, std::size_t left,
+                          std::size_t right) override {
+            return std::max(left, right) + 1;
+        }
+        std::size_t visit(const DeclarationExpr &,
+                          std::size_t initializer) override {
+            return initializer + 1;
+        }
+        std::size_t visit(const GroupingExpr &, std::size_t inner) override {
+            return inner + 1;
+        }
+        std::size_t visit(const LiteralExpr &) override { return 1; }
+        std::size_t visit(const UnaryExpr &, std::size_t right) override {
+            return right + 1;
+        }
+        std::size_t visit(const VariableExpr &) override { return 1; }
+    };
+
+    Lexer lexer(source);
+    Arena arena;
+    Parser parser(lexer, arena);
+    const Expr *expr = parser.parse().front();
+    const Expr *balanced = nullptr;
+
+    double seconds = Bench::measure(
+        [&] { balanced = Rebalancer(arena).rebalance(expr); }, 1);
+
+    Depth depth;
+    Bench::report("rebalance", seconds * 1e3, "ms");
+    Bench::report("depth before", expr->accept(depth), "");
+    Bench::report("depth after", balanced->accept(depth), "");
+}
+
+BENCH(Parser, HashConsedCodegen) {
+    const std::string source = generateGroups(1 << 20);
+
+    for (bool hashCons : {false, true}) {
+        Lexer lexer(source);
+        Arena arena;
+        Parser parser(lexer, arena, hashCons);
+        const Expr *expr = parser.parse().front();
+        ExprTypes types;
+        TypeChecker(lexer).check(expr, types);
+
+        double seconds = Bench::measure(
+            [&] {
+                Compiler compiler(lexer);
+                compiler.codegen(expr, types);
+            },
+            1);
+
+        std::string mode = hashCons ? "hash-consed " : "tree ";
+        Bench::report(mode + "nodes", parser.nodes().nodes(), "");
+        Bench::report(mode + "arena", arena.capacity() / 1e6, "MB");
+        Bench::report(mode + "codegen", seconds * 1e3, "ms");
+    }
+}
+
+BENCH(Parser, FoldBeforeCodegen) {
+    const std::string source = generateChain(1 << 20);
+
+    for (bool fold : {false, true}) {
+        Lexer lexer(source);
+        Arena arena;
+        Parser parser(lexer, arena);
+        const Expr *expr = parser.parse().front();
+
+        double seconds = Bench::measure(
+            [&] {
+                const Expr *tree = expr;
+                if (fold)
+                    tree = ConstantFolder(lexer, arena).fold(tree);
+                ExprTypes types;
+                TypeChecker(lexer).check(tree, types);
+                Compiler compiler(lexer);
+                compiler.codegen(tree, types);
+            },
+            1);
+
+        Bench::report(fold ? "fold+codegen" : "codegen", seconds * 1e3,
+                      "ms");
+    }
+}
+
+// Name resolution in a script of many variables: every identifier is hashed
+// once by the lexer, after which the parser resolves uses by symbol id.
+BENCH(Parser, ManyVariables) {
+    const unsigned count = 50000;
+    std::string source = "var v0 = 1; var v1 = 2;\n";
+    for (unsigned i = 2; i < count; i++) {
+        std::string name = "v" + std::to_string(i);
+        source += "var " + name + " = v" + std::to_string(i - 1) + " + v" +
+                  std::to_string(i - 2) + ";";
+        source += i % 100 == 0 ? " { var " + name + " = " + name + "; }\n"
+                               : "\n";
+    }
+    const std::size_t names = 3 * count;
+
+    double lex = Bench::measure([&] { Lexer(source).scanTokens(); });
+    double parse = Bench::measure([&] {
+        Lexer lexer(source);
+        Arena arena;
+        Parser parser(lexer, arena);
+        parser.parse();
+    });
+
+    Bench::report("lex", lex * 1e3, "ms");
+    Bench::report("lex+parse", parse * 1e3, "ms");
+    Bench::report("lex+parse per name", parse / names * 1e9, "ns");
+}
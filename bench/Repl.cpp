@@ -0,0 +1,34 @@
+#include "Bench.hpp"
+
+#include "Repl.hpp"
+
+#include <chrono>
+#include <sstream>
+
+// Time per line early in a long session versus late in it; with every
+// line's module released once it has run the two should match.
+BENCH(Repl, LatencyOverManyLines) {
+    Options options;
+    llvm::raw_null_ostream out;
+    std::ostringstream errors;
+    Repl repl(options, out, errors);
+
+    const unsigned lines = 5000, window = 500;
+    double first = 0, last = 0;
+    for (unsigned i = 0; i < lines; i++) {
+        std::string line = std::to_string(i) + " * 2 + \"x\"; " +
+                           std::to_string(i) + " < 3";
+        auto begin = std::chrono::steady_clock::now();
+        repl.eval(line);
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - begin)
+                             .count();
+        if (i < window)
+            first += seconds;
+        else if (i >= lines - window)
+            last += seconds;
+    }
+
+    Bench::report("first 500 lines", first / window * 1e6, "us/line");
+    Bench::report("last 500 lines", last / window * 1e6, "us/line");
+}
@@ -0,0 +1,23 @@
+#include "Bench.hpp"
+
+#include "Runtime.hpp"
+
+// Per-piece cost of building one long string by repeated concatenation and
+// reading it back; flat across sizes while ropes keep it linear.
+BENCH(Runtime, ConcatenationChain) {
+    for (int pieces : {10000, 100000, 1000000}) {
+        std::size_t length = 0;
+        double seconds = Bench::measure([&] {
+            ToyString *piece = toy_string_literal("piece", 5);
+            ToyString *built = toy_string_literal("", 0);
+            for (int i = 0; i < pieces; i++)
+                built = toy_string_concat(built, piece);
+            length = std::string_view(toy_string_data(built)).size();
+            toy_string_release();
+        });
+        Bench::report(std::to_string(pieces) + " pieces",
+                      seconds / pieces * 1e9, "ns/piece");
+        if (length != 5u * pieces)
+            std::printf("  wrong length %zu\n", length);
+    }
+}
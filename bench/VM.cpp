@@ -0,0 +1,82 @@
+#include "Bench.hpp"
+
+#include "JIT.hpp"
+#include "Session.hpp"
+#include "VM.hpp"
+
+// Source to first result for a REPL-sized line: bytecode and the VM versus
+// a fresh LLVM module through a JIT that is already running.
+BENCH(VM, StartupLatency) {
+    const std::string line = "(1 + 2) * 3.5 >= 10 and !(4 / 2 == 1)";
+    Options options;
+    options.fold = false;
+    const int repeat = 200;
+
+    JIT jit;
+    unsigned lines = 0;
+    double llvm = Bench::measure(
+        [&] {
+            for (int i = 0; i < repeat; i++) {
+                Session session(line, options,
+                                "line" + std::to_string(lines++));
+                session.compile();
+                auto tracker =
+                    jit.addTracked(session.compiler().takeModule());
+                const Session::Entry &entry = session.entries()[0];
+                Session::call(entry, jit.lookup<void>(entry.name));
+                jit.remove(tracker);
+            }
+        },
+        1);
+
+    options.vm = true;
+    VM vm;
+    double interpreted = Bench::measure(
+        [&] {
+            for (int i = 0; i < repeat; i++) {
+                Session session(line, options, "line");
+                session.compile();
+                vm.run(session.bytecode()[0]);
+            }
+        },
+        1);
+
+    Bench::report("llvm+jit", llvm / repeat * 1e6, "us/line");
+    Bench::report("vm", interpreted / repeat * 1e6, "us/line");
+}
+
+// Interpreter throughput on a long unfolded statement, in double and in
+// i64 arithmetic.
+BENCH(VM, OpsPerSecond) {
+    static const char *const doubles[] = {"0.0", " + 1.5", " * 0.5",
+                                          " - 2.0", " < 1.0 == (1.0 > 0.0)"};
+    static const char *const integers[] = {"0", " + 3", " * 5", " - 2",
+                                           " < 1 == (1 > 0)"};
+
+    for (const char *const *terms : {doubles, integers}) {
+        std::string source = terms[0];
+        for (int i = 0; i < 100000; i++)
+            source += terms[1 + i % 3];
+        source += terms[4];
+
+        Options options;
+        options.fold = false;
+        options.vm = true;
+        Session session(source, options, "ops");
+        session.compile();
+        const Chunk &chunk = session.bytecode()[0];
+
+        VM vm;
+        const int repeat = 100;
+        double seconds = Bench::measure(
+            [&] {
+                for (int i = 0; i < repeat; i++)
+                    vm.run(chunk);
+            });
+
+        std::string mode = terms == integers ? "integer " : "double ";
+        Bench::report(mode + "code", chunk.code.size() / 1e3, "KB");
+        Bench::report(mode + "throughput",
+                      200008.0 * repeat / seconds / 1e6, "Mops/s");
+    }
+}
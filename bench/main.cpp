@@ -0,0 +1,31 @@
+#include "Bench.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+std::atomic<std::size_t> Bench::allocationCount{0};
+
+void *operator new(std::size_t size) {
+    Bench::allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char const *argv[]) {
+    const char *filter = argc > 1 ? argv[1] : "";
+
+    for (const Bench::Entry &entry : Bench::registry()) {
+        if (std::strstr(entry.name, filter) == nullptr)
+            continue;
+        std::printf("%s\n", entry.name);
+        entry.function();
+    }
+
+    return 0;
+}
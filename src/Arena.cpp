@@ -0,0 +1,15 @@
+#include "Arena.hpp"
+
+#include <algorithm>
+
+void *Arena::grow(std::size_t size, std::size_t align) {
+    // Blocks come from operator new[], which aligns for any fundamental type.
+    std::size_t blockSize = std::max(nextBlockSize, size + align);
+    blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(blockSize));
+    reserved += blockSize;
+    nextBlockSize = std::min(nextBlockSize * 2, MaxBlockSize);
+
+    cursor = blocks.back().get();
+    limit = cursor + blockSize;
+    return allocate(size, align);
+}
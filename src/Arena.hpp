@@ -0,0 +1,55 @@
+#ifndef TOYLANG_ARENA_HPP
+#define TOYLANG_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for objects that live exactly as long as one parse. Objects
+// are never destroyed individually: the arena hands back all of its blocks
+// at once when it goes away, so only trivially destructible types may be
+// placed in it.
+class Arena {
+  public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    template <typename T, typename... Args> T *make(Args &&...args) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "arena objects are never destroyed");
+        void *memory = allocate(sizeof(T), alignof(T));
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    void *allocate(std::size_t size, std::size_t align) {
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(cursor);
+        std::uintptr_t aligned = (address + align - 1) & ~(align - 1);
+        if (cursor == nullptr ||
+            aligned + size > reinterpret_cast<std::uintptr_t>(limit))
+            return grow(size, align);
+        cursor = reinterpret_cast<std::byte *>(aligned + size);
+        return reinterpret_cast<void *>(aligned);
+    }
+
+    // Bytes reserved from the system so far.
+    std::size_t capacity() const { return reserved; }
+
+  private:
+    static constexpr std::size_t FirstBlockSize = 64 << 10;
+    static constexpr std::size_t MaxBlockSize = 4 << 20;
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte *cursor = nullptr;
+    std::byte *limit = nullptr;
+    std::size_t nextBlockSize = FirstBlockSize;
+    std::size_t reserved = 0;
+
+    void *grow(std::size_t size, std::size_t align);
+};
+
+#endif
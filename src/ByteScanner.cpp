@@ -0,0 +1,166 @@
+#include "ByteScanner.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define TOYLANG_HAVE_X86_SIMD 1
+#endif
+
+namespace {
+
+const char *findScalar(const char *p, const char *end, char c) {
+    while (p < end && *p != c)
+        p++;
+    return p;
+}
+
+std::size_t countScalar(const char *p, const char *end, char c) {
+    std::size_t n = 0;
+    for (; p < end; p++)
+        n += *p == c;
+    return n;
+}
+
+bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+const char *skipWhitespaceScalar(const char *p, const char *end) {
+    while (p < end && isWhitespace(*p))
+        p++;
+    return p;
+}
+
+#ifdef TOYLANG_HAVE_X86_SIMD
+
+const char *findSSE2(const char *p, const char *end, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+    return findScalar(p, end, c);
+}
+
+std::size_t countSSE2(const char *p, const char *end, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    std::size_t n = 0;
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        n += __builtin_popcount(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+    }
+    return n + countScalar(p, end, c);
+}
+
+const char *skipWhitespaceSSE2(const char *p, const char *end) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+                         _mm_cmpeq_epi8(chunk, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, cr), _mm_cmpeq_epi8(chunk, nl)));
+        int mask = ~_mm_movemask_epi8(ws) & 0xFFFF;
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+    return skipWhitespaceScalar(p, end);
+}
+
+__attribute__((target("avx2"))) const char *findAVX2(const char *p,
+                                                     const char *end, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    for (; end - p >= 32; p += 32) {
+        __m256i chunk =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+    return findSSE2(p, end, c);
+}
+
+__attribute__((target("avx2"))) std::size_t
+countAVX2(const char *p, const char *end, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    std::size_t n = 0;
+    for (; end - p >= 32; p += 32) {
+        __m256i chunk =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        n += __builtin_popcount(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+    }
+    return n + countSSE2(p, end, c);
+}
+
+__attribute__((target("avx2"))) const char *
+skipWhitespaceAVX2(const char *p, const char *end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for (; end - p >= 32; p += 32) {
+        __m256i chunk =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i ws = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space),
+                            _mm256_cmpeq_epi8(chunk, tab)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, cr),
+                            _mm256_cmpeq_epi8(chunk, nl)));
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(ws));
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+    return skipWhitespaceSSE2(p, end);
+}
+
+#endif
+
+struct Dispatch {
+    const char *(*find)(const char *, const char *, char);
+    std::size_t (*count)(const char *, const char *, char);
+    const char *(*skipWhitespace)(const char *, const char *);
+    const char *name;
+};
+
+Dispatch select() {
+#ifdef TOYLANG_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return {findAVX2, countAVX2, skipWhitespaceAVX2, "avx2"};
+    return {findSSE2, countSSE2, skipWhitespaceSSE2, "sse2"};
+#else
+    return {findScalar, countScalar, skipWhitespaceScalar, "scalar"};
+#endif
+}
+
+const Dispatch &dispatch() {
+    static const Dispatch selected = select();
+    return selected;
+}
+
+} // namespace
+
+const char *ByteScanner::find(const char *begin, const char *end, char c) {
+    return dispatch().find(begin, end, c);
+}
+
+std::size_t ByteScanner::count(const char *begin, const char *end, char c) {
+    return dispatch().count(begin, end, c);
+}
+
+const char *ByteScanner::skipWhitespace(const char *begin, const char *end) {
+    // Most gaps between tokens are one or two bytes; only go wide for runs.
+    for (int i = 0; i < 2; i++, begin++) {
+        if (begin == end || !isWhitespace(*begin))
+            return begin;
+    }
+    return dispatch().skipWhitespace(begin, end);
+}
+
+const char *ByteScanner::isa() { return dispatch().name; }
@@ -0,0 +1,24 @@
+#ifndef TOYLANG_BYTESCANNER_HPP
+#define TOYLANG_BYTESCANNER_HPP
+
+#include <cstddef>
+
+// Bulk byte searches used by the Lexer to skip whitespace, comments and
+// string bodies. Each routine has AVX2, SSE2 and scalar versions; the widest
+// one the host CPU supports is picked once, at first use.
+class ByteScanner {
+  public:
+    // First position in [begin, end) holding c, or end.
+    static const char *find(const char *begin, const char *end, char c);
+
+    // Number of bytes in [begin, end) equal to c.
+    static std::size_t count(const char *begin, const char *end, char c);
+
+    // First position in [begin, end) that is not ' ', '\t', '\r' or '\n'.
+    static const char *skipWhitespace(const char *begin, const char *end);
+
+    // Name of the selected implementation: "avx2", "sse2" or "scalar".
+    static const char *isa();
+};
+
+#endif
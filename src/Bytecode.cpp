@@ -0,0 +1,65 @@
+#include "Bytecode.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+
+static const char *const names[] = {
+    "Number", "Integer", "True", "False", "Null", "String", "GetVariable",
+    "SetVariable", "Add", "Subtract", "Multiply", "Divide", "Negate",
+    "AddInt", "SubtractInt", "MultiplyInt", "NegateInt", "Greater",
+    "GreaterEqual", "Less", "LessEqual", "Equal", "NotEqual", "GreaterInt",
+    "GreaterEqualInt", "LessInt", "LessEqualInt", "EqualInt", "NotEqualInt",
+    "EqualBool", "NotEqualBool", "And", "Or", "Not", "IntToNumber",
+    "NumberToString", "IntToString", "BoolToString", "Concat", "Return",
+};
+
+static_assert(std::size(names) == static_cast<std::size_t>(OpCode::Return) + 1,
+              "names is out of sync with OpCode");
+
+std::string Chunk::disassemble() const {
+    std::ostringstream text;
+    for (std::size_t offset = 0; offset < code.size();) {
+        auto op = static_cast<OpCode>(code[offset]);
+        char address[24];
+        std::snprintf(address, sizeof(address), "%04zu", offset);
+        text << address << ' ' << names[code[offset]];
+        offset++;
+
+        std::uint32_t index;
+        switch (op) {
+        case OpCode::Number:
+            std::memcpy(&index, &code[offset], sizeof(index));
+            offset += sizeof(index);
+            text << ' ' << numbers[index];
+            break;
+        case OpCode::Integer:
+            std::memcpy(&index, &code[offset], sizeof(index));
+            offset += sizeof(index);
+            text << ' ' << integers[index];
+            break;
+        case OpCode::String:
+            std::memcpy(&index, &code[offset], sizeof(index));
+            offset += sizeof(index);
+            text << " \"" << strings[index] << '"';
+            break;
+        case OpCode::GetVariable:
+        case OpCode::SetVariable:
+            std::memcpy(&index, &code[offset], sizeof(index));
+            offset += sizeof(index);
+            text << ' ' << index;
+            break;
+        case OpCode::IntToNumber:
+        case OpCode::NumberToString:
+        case OpCode::IntToString:
+        case OpCode::BoolToString:
+            text << ' ' << unsigned(code[offset++]);
+            break;
+        default:
+            break;
+        }
+        text << '\n';
+    }
+    return text.str();
+}
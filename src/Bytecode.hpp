@@ -0,0 +1,76 @@
+#ifndef TOYLANG_BYTECODE_HPP
+#define TOYLANG_BYTECODE_HPP
+
+#include "Expr.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Instructions of the stack machine. Every operand type is known when the
+// code is generated, so each instruction works on one type and the VM
+// never checks a tag; the Int instructions work on i64s, wrapping on
+// overflow. Number, Integer and String take a 32-bit constant index and
+// the variable instructions a 32-bit slot; the conversions (IntToNumber
+// and the ToString ones) a one-byte stack depth (0 is the top, 1 the value
+// below it). Keep VM::run's label table in this order.
+enum class OpCode : std::uint8_t {
+    Number,
+    Integer,
+    True,
+    False,
+    Null,
+    String,
+    GetVariable,
+    SetVariable,
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Negate,
+    AddInt,
+    SubtractInt,
+    MultiplyInt,
+    NegateInt,
+    Greater,
+    GreaterEqual,
+    Less,
+    LessEqual,
+    Equal,
+    NotEqual,
+    GreaterInt,
+    GreaterEqualInt,
+    LessInt,
+    LessEqualInt,
+    EqualInt,
+    NotEqualInt,
+    EqualBool,
+    NotEqualBool,
+    And,
+    Or,
+    Not,
+    IntToNumber,
+    NumberToString,
+    IntToString,
+    BoolToString,
+    Concat,
+    Return,
+};
+
+// The code of one statement, with its constants and result type (Unknown
+// for a declaration, which has no result).
+struct Chunk {
+    std::vector<std::uint8_t> code;
+    std::vector<double> numbers;
+    std::vector<std::int64_t> integers;
+    std::vector<std::string> strings;
+    ValueType type = ValueType::Unknown;
+    std::uint32_t maxStack = 0;
+    // One more than the highest slot the code uses.
+    std::uint32_t variables = 0;
+
+    // One instruction per line, e.g. "0000 Number 1.5".
+    std::string disassemble() const;
+};
+
+#endif
@@ -0,0 +1,265 @@
+#include "BytecodeCompiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+Chunk BytecodeCompiler::compile(const Expr *expr, const ExprTypes &types) {
+    this->types = &types;
+    chunk = Chunk();
+    depth = 0;
+    return finish(expr->accept(*this));
+}
+
+Chunk BytecodeCompiler::compile(const FlatAST &ast) {
+    chunk = Chunk();
+    depth = 0;
+
+    std::vector<ValueType> types;
+    for (FlatAST::Index node = 0; node < ast.size(); node++) {
+        switch (ast.kind(node)) {
+        case ExprKind::Binary: {
+            ValueType right = types.back();
+            types.pop_back();
+            types.back() = binary(ast.token(node), types.back(), right);
+            break;
+        }
+        case ExprKind::Declaration:
+            types.back() = declare(ast.slot(node));
+            break;
+        case ExprKind::Grouping:
+            break;
+        case ExprKind::Literal:
+            types.push_back(literal(ast.token(node)));
+            break;
+        case ExprKind::Unary:
+            types.back() = unary(ast.token(node), types.back());
+            break;
+        case ExprKind::Variable:
+            types.push_back(variable(ast.slot(node), ast.type(node)));
+            break;
+        }
+    }
+
+    return finish(types.back());
+}
+
+Chunk BytecodeCompiler::finish(ValueType type) {
+    emit(OpCode::Return);
+    chunk.type = type;
+    return std::move(chunk);
+}
+
+ValueType BytecodeCompiler::visit(const BinaryExpr &expr, ValueType left,
+                                  ValueType right) {
+    return binary(expr.op, left, right);
+}
+
+ValueType BytecodeCompiler::visit(const DeclarationExpr &expr, ValueType) {
+    return declare(expr.slot);
+}
+
+ValueType BytecodeCompiler::visit(const GroupingExpr &, ValueType expression) {
+    return expression;
+}
+
+ValueType BytecodeCompiler::visit(const LiteralExpr &expr) {
+    return literal(expr.value);
+}
+
+ValueType BytecodeCompiler::visit(const UnaryExpr &expr, ValueType right) {
+    return unary(expr.op, right);
+}
+
+ValueType BytecodeCompiler::visit(const VariableExpr &expr) {
+    return variable(expr.slot, (*types)[&expr]);
+}
+
+// Operand types come from TypeChecker, so they always fit the operator;
+// + with a string on either side concatenates, with the other operand
+// formatted as Compiler formats it.
+ValueType BytecodeCompiler::binary(const Token &op, ValueType left,
+                                   ValueType right) {
+    depth--;
+    if (op.type == TokenType::PLUS &&
+        (left == ValueType::String || right == ValueType::String)) {
+        toString(left, 1);
+        toString(right, 0);
+        emit(OpCode::Concat);
+        return ValueType::String;
+    }
+
+    if (left == ValueType::Bool) {
+        switch (op.type) {
+        case TokenType::AND:
+            emit(OpCode::And);
+            break;
+        case TokenType::OR:
+            emit(OpCode::Or);
+            break;
+        case TokenType::EQUAL_EQUAL:
+            emit(OpCode::EqualBool);
+            break;
+        default:
+            emit(OpCode::NotEqualBool);
+            break;
+        }
+        return ValueType::Bool;
+    }
+
+    if (arithmeticType(op.type, left, right) == ValueType::Integer) {
+        switch (op.type) {
+        case TokenType::PLUS:
+            emit(OpCode::AddInt);
+            return ValueType::Integer;
+        case TokenType::MINUS:
+            emit(OpCode::SubtractInt);
+            return ValueType::Integer;
+        case TokenType::STAR:
+            emit(OpCode::MultiplyInt);
+            return ValueType::Integer;
+        case TokenType::GREATER:
+            emit(OpCode::GreaterInt);
+            break;
+        case TokenType::GREATER_EQUAL:
+            emit(OpCode::GreaterEqualInt);
+            break;
+        case TokenType::LESS:
+            emit(OpCode::LessInt);
+            break;
+        case TokenType::LESS_EQUAL:
+            emit(OpCode::LessEqualInt);
+            break;
+        case TokenType::EQUAL_EQUAL:
+            emit(OpCode::EqualInt);
+            break;
+        default:
+            emit(OpCode::NotEqualInt);
+            break;
+        }
+        return ValueType::Bool;
+    }
+
+    if (left == ValueType::Integer) {
+        emit(OpCode::IntToNumber);
+        chunk.code.push_back(1);
+    }
+    if (right == ValueType::Integer) {
+        emit(OpCode::IntToNumber);
+        chunk.code.push_back(0);
+    }
+
+    switch (op.type) {
+    case TokenType::PLUS:
+        emit(OpCode::Add);
+        return ValueType::Number;
+    case TokenType::MINUS:
+        emit(OpCode::Subtract);
+        return ValueType::Number;
+    case TokenType::STAR:
+        emit(OpCode::Multiply);
+        return ValueType::Number;
+    case TokenType::SLASH:
+        emit(OpCode::Divide);
+        return ValueType::Number;
+    case TokenType::GREATER:
+        emit(OpCode::Greater);
+        return ValueType::Bool;
+    case TokenType::GREATER_EQUAL:
+        emit(OpCode::GreaterEqual);
+        return ValueType::Bool;
+    case TokenType::LESS:
+        emit(OpCode::Less);
+        return ValueType::Bool;
+    case TokenType::LESS_EQUAL:
+        emit(OpCode::LessEqual);
+        return ValueType::Bool;
+    case TokenType::EQUAL_EQUAL:
+        emit(OpCode::Equal);
+        return ValueType::Bool;
+    default:
+        emit(OpCode::NotEqual);
+        return ValueType::Bool;
+    }
+}
+
+ValueType BytecodeCompiler::literal(const Token &value) {
+    push();
+    switch (value.type) {
+    case TokenType::NUMBER:
+        chunk.numbers.push_back(lexer.literals().number(value));
+        emit(OpCode::Number, chunk.numbers.size() - 1);
+        return ValueType::Number;
+    case TokenType::INTEGER:
+        chunk.integers.push_back(lexer.literals().integer(value));
+        emit(OpCode::Integer, chunk.integers.size() - 1);
+        return ValueType::Integer;
+    case TokenType::TRUE:
+        emit(OpCode::True);
+        return ValueType::Bool;
+    case TokenType::FALSE:
+        emit(OpCode::False);
+        return ValueType::Bool;
+    case TokenType::STRING:
+        chunk.strings.emplace_back(lexer.literals().string(value));
+        emit(OpCode::String, chunk.strings.size() - 1);
+        return ValueType::String;
+    default:
+        emit(OpCode::Null);
+        return ValueType::Null;
+    }
+}
+
+ValueType BytecodeCompiler::unary(const Token &op, ValueType operand) {
+    if (op.type == TokenType::MINUS) {
+        emit(operand == ValueType::Integer ? OpCode::NegateInt
+                                           : OpCode::Negate);
+        return operand;
+    }
+    emit(OpCode::Not);
+    return ValueType::Bool;
+}
+
+// The value stays on the stack for Return, but a declaration's chunk has
+// no result.
+ValueType BytecodeCompiler::declare(std::uint32_t slot) {
+    emit(OpCode::SetVariable, slot);
+    chunk.variables = std::max(chunk.variables, slot + 1);
+    return ValueType::Unknown;
+}
+
+ValueType BytecodeCompiler::variable(std::uint32_t slot, ValueType type) {
+    push();
+    emit(OpCode::GetVariable, slot);
+    chunk.variables = std::max(chunk.variables, slot + 1);
+    return type;
+}
+
+void BytecodeCompiler::emit(OpCode op) {
+    chunk.code.push_back(static_cast<std::uint8_t>(op));
+}
+
+void BytecodeCompiler::emit(OpCode op, std::uint32_t operand) {
+    emit(op);
+    std::size_t at = chunk.code.size();
+    chunk.code.resize(at + sizeof(operand));
+    std::memcpy(&chunk.code[at], &operand, sizeof(operand));
+}
+
+void BytecodeCompiler::push() {
+    depth++;
+    chunk.maxStack = std::max(chunk.maxStack, depth);
+}
+
+// Converts the operand depth values below the top to a string in place.
+void BytecodeCompiler::toString(ValueType type, std::uint8_t depth) {
+    if (type == ValueType::Number) {
+        emit(OpCode::NumberToString);
+        chunk.code.push_back(depth);
+    } else if (type == ValueType::Integer) {
+        emit(OpCode::IntToString);
+        chunk.code.push_back(depth);
+    } else if (type == ValueType::Bool) {
+        emit(OpCode::BoolToString);
+        chunk.code.push_back(depth);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef TOYLANG_BYTECODECOMPILER_HPP
+#define TOYLANG_BYTECODECOMPILER_HPP
+
+#include "Bytecode.hpp"
+#include "Expr.hpp"
+#include "FlatAST.hpp"
+#include "Lexer.hpp"
+#include "Token.hpp"
+
+// Generates VM bytecode for a statement checked by TypeChecker, with the
+// semantics of Compiler, whose IR it replaces when startup matters more
+// than peak speed: there is no LLVMContext to create and nothing to JIT.
+// Nodes are visited in post-order, which is exactly stack machine order.
+class BytecodeCompiler : public ExprVisitor<ValueType> {
+  public:
+    BytecodeCompiler(Lexer &lexer) : lexer(lexer) {}
+
+    // types holds what TypeChecker recorded for expr.
+    Chunk compile(const Expr *expr, const ExprTypes &types);
+    Chunk compile(const FlatAST &ast);
+
+    // Shared subtrees must be emitted at every use.
+    bool reuseShared() const override { return false; }
+
+    ValueType visit(const BinaryExpr &expr, ValueType left,
+                    ValueType right) override;
+    ValueType visit(const DeclarationExpr &expr,
+                    ValueType initializer) override;
+    ValueType visit(const GroupingExpr &expr, ValueType expression) override;
+    ValueType visit(const LiteralExpr &expr) override;
+    ValueType visit(const UnaryExpr &expr, ValueType right) override;
+    ValueType visit(const VariableExpr &expr) override;
+
+  private:
+    Lexer &lexer;
+    const ExprTypes *types = nullptr;
+    Chunk chunk;
+    std::uint32_t depth = 0;
+
+    Chunk finish(ValueType type);
+
+    ValueType binary(const Token &op, ValueType left, ValueType right);
+    ValueType literal(const Token &value);
+    ValueType unary(const Token &op, ValueType operand);
+    ValueType declare(std::uint32_t slot);
+    ValueType variable(std::uint32_t slot, ValueType type);
+
+    void emit(OpCode op);
+    void emit(OpCode op, std::uint32_t operand);
+    void push();
+    void toString(ValueType type, std::uint8_t depth);
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "CompileCache.hpp"
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+#ifndef TOYLANG_VERSION
+#define TOYLANG_VERSION "unknown"
+#endif
+
+// Bump when the layout of an entry or the meaning of a ValueType changes.
+static constexpr std::uint32_t CacheFormat = 3;
+
+// A temporary this old was left by a store that crashed, not one that is
+// still writing.
+static constexpr auto StaleTemporaryAge = std::chrono::hours(1);
+
+CompileCache::CompileCache(std::string directory, std::uint64_t limit)
+    : directory(std::move(directory)), limit(limit) {}
+
+std::string CompileCache::defaultDirectory() {
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return std::string(xdg) + "/toylang";
+    if (const char *home = std::getenv("HOME"); home && *home)
+        return std::string(home) + "/.cache/toylang";
+    return (std::filesystem::temp_directory_path() / "toylang").string();
+}
+
+// Length-prefixed, so that no two different field lists hash alike.
+static void hashField(llvm::SHA256 &hash, std::string_view field) {
+    std::uint64_t size = field.size();
+    hash.update(llvm::ArrayRef<std::uint8_t>(
+        reinterpret_cast<const std::uint8_t *>(&size), sizeof(size)));
+    hash.update(llvm::StringRef(field.data(), field.size()));
+}
+
+std::string CompileCache::key(std::string_view source, const Options &options,
+                              std::string_view entryPrefix,
+                              const llvm::TargetMachine &machine) {
+    std::string settings = std::to_string(CacheFormat) + ' ' + TOYLANG_VERSION +
+                           ' ' + LLVM_VERSION_STRING;
+    settings += " -O" + std::to_string(options.optLevel);
+    settings += options.fastMath ? " fast-math" : "";
+    settings += options.fold ? " fold" : "";
+    settings += options.rebalance ? " rebalance" : "";
+    settings += options.hashCons ? " hash-cons" : "";
+    settings += options.compileOnly ? " object" : " jit";
+
+    llvm::SHA256 hash;
+    hashField(hash, settings);
+    // A shared or restored cache directory may be read on another CPU.
+    hashField(hash, machine.getTargetTriple().str());
+    hashField(hash, machine.getTargetCPU());
+    hashField(hash, machine.getTargetFeatureString());
+    hashField(hash, entryPrefix);
+    hashField(hash, source);
+    return llvm::toHex(hash.final(), true);
+}
+
+std::string CompileCache::path(const std::string &key) const {
+    return directory + "/" + key + ".toyc";
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+CompileCache::lookup(const std::string &key) {
+    auto buffer = llvm::MemoryBuffer::getFile(path(key));
+    if (!buffer) {
+        missCount++;
+        return nullptr;
+    }
+
+    // Eviction goes by modification time, so a hit marks the entry used.
+    std::error_code error;
+    std::filesystem::last_write_time(
+        path(key), std::filesystem::file_time_type::clock::now(), error);
+
+    hitCount++;
+    return std::move(*buffer);
+}
+
+void CompileCache::invalidate(const std::string &key) {
+    std::error_code error;
+    std::filesystem::remove(path(key), error);
+    hitCount--;
+    missCount++;
+}
+
+void CompileCache::store(const std::string &key, llvm::StringRef contents) {
+    if (llvm::sys::fs::create_directories(directory))
+        return;
+
+    int fd;
+    llvm::SmallString<128> temporary;
+    if (llvm::sys::fs::createUniqueFile(directory + "/%%%%%%%%%%%%.tmp", fd,
+                                        temporary))
+        return;
+
+    {
+        llvm::raw_fd_ostream out(fd, true);
+        out << contents;
+        out.close();
+        if (out.has_error()) {
+            out.clear_error();
+            llvm::sys::fs::remove(temporary);
+            return;
+        }
+    }
+
+    if (llvm::sys::fs::rename(temporary, path(key))) {
+        llvm::sys::fs::remove(temporary);
+        return;
+    }
+    storeCount++;
+}
+
+void CompileCache::evict() {
+    struct Entry {
+        std::filesystem::path path;
+        std::filesystem::file_time_type used;
+        std::uintmax_t size;
+    };
+    std::vector<Entry> entries;
+    std::uint64_t total = 0;
+
+    auto stale = std::filesystem::file_time_type::clock::now() -
+                 StaleTemporaryAge;
+    std::error_code error;
+    for (const auto &file :
+         std::filesystem::directory_iterator(directory, error)) {
+        std::error_code statError;
+        if (file.path().extension() == ".tmp") {
+            if (file.last_write_time(statError) < stale && !statError)
+                std::filesystem::remove(file.path(), statError);
+            continue;
+        }
+        if (file.path().extension() != ".toyc")
+            continue;
+        Entry entry{file.path(), file.last_write_time(statError),
+                    file.file_size(statError)};
+        if (statError)
+            continue;
+        total += entry.size;
+        entries.push_back(std::move(entry));
+    }
+
+    if (total <= limit)
+        return;
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b) { return a.used < b.used; });
+    for (const Entry &entry : entries) {
+        if (total <= limit)
+            break;
+        if (std::filesystem::remove(entry.path, error)) {
+            total -= entry.size;
+            evictionCount++;
+        }
+    }
+}
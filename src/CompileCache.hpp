@@ -0,0 +1,67 @@
+#ifndef TOYLANG_COMPILECACHE_HPP
+#define TOYLANG_COMPILECACHE_HPP
+
+#include "Options.hpp"
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// On-disk store of compiled scripts, one file per key. A key hashes
+// everything the compiled code depends on, so entries never need to be
+// invalidated, only evicted: the least recently used ones go once the
+// directory grows past its size limit. Lookups and stores may run on many
+// threads at once.
+class CompileCache {
+  public:
+    CompileCache(std::string directory, std::uint64_t limit);
+
+    // $XDG_CACHE_HOME/toylang, ~/.cache/toylang or a temporary directory.
+    static std::string defaultDirectory();
+
+    // Hex SHA-256 of source, the ToyLang and LLVM versions, every option
+    // that changes the generated code, and the triple, CPU and features of
+    // the machine the code is compiled for.
+    static std::string key(std::string_view source, const Options &options,
+                           std::string_view entryPrefix,
+                           const llvm::TargetMachine &machine);
+
+    // The contents stored under key, or nullptr on a miss.
+    std::unique_ptr<llvm::MemoryBuffer> lookup(const std::string &key);
+
+    // Drops an entry lookup() returned that turned out to be unreadable;
+    // it counts as a miss instead.
+    void invalidate(const std::string &key);
+
+    // Writes contents under key. They go to a temporary file that is then
+    // renamed into place, so readers never see a partial entry.
+    void store(const std::string &key, llvm::StringRef contents);
+
+    // Deletes least recently used entries until the cache fits its limit,
+    // and temporaries that stores which crashed left behind.
+    void evict();
+
+    std::uint64_t hits() const { return hitCount; }
+    std::uint64_t misses() const { return missCount; }
+    std::uint64_t stores() const { return storeCount; }
+    std::uint64_t evictions() const { return evictionCount; }
+
+  private:
+    const std::string directory;
+    const std::uint64_t limit;
+
+    std::atomic<std::uint64_t> hitCount = 0;
+    std::atomic<std::uint64_t> missCount = 0;
+    std::atomic<std::uint64_t> storeCount = 0;
+    std::atomic<std::uint64_t> evictionCount = 0;
+
+    std::string path(const std::string &key) const;
+};
+
+#endif
@@ -1,77 +1,381 @@
 #include "Compiler.hpp"
+#include "Runtime.hpp"
 
-#include <sstream>
+#include <llvm/IR/ProfileSummary.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Passes/PassBuilder.h>
 
-std::unique_ptr<llvm::LLVMContext> Compiler::TheContext =
-    std::make_unique<llvm::LLVMContext>();
-std::unique_ptr<llvm::Module> Compiler::TheModule =
-    std::make_unique<llvm::Module>("toy", *TheContext);
-std::unique_ptr<llvm::IRBuilder<>> Compiler::Builder =
-    std::make_unique<llvm::IRBuilder<>>(*TheContext);
+#include <algorithm>
+#include <sstream>
 
-llvm::Value *Compiler::error(Token token, std::string message) {
-    ToyLang::error(token, message);
-    return nullptr;
+Compiler::Compiler(Lexer &lexer, bool fastMath)
+    : lexer(lexer), fastMath(fastMath) {
+    reset();
 }
 
-llvm::Value *Compiler::codegen(std::unique_ptr<Expr<llvm::Value *>> &expr) {
+llvm::Value *Compiler::codegen(const Expr *expr, const ExprTypes &types) {
+    this->types = &types;
     return expr->accept(*this);
 }
 
-llvm::Value *Compiler::visit(BinaryExpr<llvm::Value *> &expr) {
-    llvm::Value *L = codegen(expr.left);
-    llvm::Value *R = codegen(expr.right);
-    if (L == nullptr || R == nullptr) {
-        return nullptr;
-    }
-
-    if (L->getType()->getTypeID() == llvm::Type::ArrayTyID) {
-        std::string str1 =
-            cast<llvm::ConstantDataArray>(L)->getAsString().str();
-        str1.pop_back();
-
-        if (R->getType()->getTypeID() == llvm::Type::ArrayTyID) {
-            auto str2 = cast<llvm::ConstantDataArray>(R)->getAsString().str();
-            str2.pop_back();
-            return llvm::ConstantDataArray::getString(*TheContext, str1 + str2);
-        } else if (R->getType()->getTypeID() == llvm::Type::DoubleTyID) {
-            std::stringstream ss;
-            ss << str1
-               << cast<llvm::ConstantFP>(R)->getValueAPF().convertToDouble();
-            return llvm::ConstantDataArray::getString(*TheContext, ss.str());
-        } else if (R->getType()->getTypeID() == llvm::Type::IntegerTyID) {
-            std::stringstream ss;
-            ss << str1 << cast<llvm::ConstantInt>(R)->getSExtValue();
-            return llvm::ConstantDataArray::getString(*TheContext, ss.str());
-        } else {
-            return error(expr.op, "Invalid string concatenation.");
+void Compiler::begin() {
+    // The return type is only known once the body is generated, so the
+    // body is built in a scratch function and moved over in finish().
+    body = llvm::Function::Create(
+        llvm::FunctionType::get(Builder->getVoidTy(), false),
+        llvm::Function::PrivateLinkage, "body", *TheModule);
+    Builder->SetInsertPoint(llvm::BasicBlock::Create(*TheContext, "entry", body));
+}
+
+llvm::Function *Compiler::finish(const std::string &name, ValueType type,
+                                 llvm::Value *value) {
+    if (value != nullptr && type == ValueType::String) {
+        if (auto *array = llvm::dyn_cast<llvm::ConstantDataArray>(value))
+            value = global(array);
+        else
+            value = Builder->CreateCall(
+                runtime("toy_string_data", Builder->getInt8PtrTy(),
+                        {Builder->getInt8PtrTy()}),
+                {value}, "data");
+    }
+
+    llvm::Function *function = nullptr;
+    if (value != nullptr) {
+        llvm::Type *result = type == ValueType::Unknown ? Builder->getVoidTy()
+                                                        : value->getType();
+        function = llvm::Function::Create(
+            llvm::FunctionType::get(result, false),
+            llvm::Function::ExternalLinkage, name, *TheModule);
+        function->getBasicBlockList().splice(function->end(),
+                                             body->getBasicBlockList());
+        // Called from C and C++ as bool(*)(), which expects it widened.
+        if (type == ValueType::Bool)
+            function->addRetAttr(llvm::Attribute::ZExt);
+        if (type == ValueType::Unknown)
+            Builder->CreateRetVoid();
+        else
+            Builder->CreateRet(value);
+
+        if (profiling) {
+            auto *counter = new llvm::GlobalVariable(
+                *TheModule, Builder->getInt64Ty(), false,
+                llvm::GlobalValue::ExternalLinkage, Builder->getInt64(0),
+                name + ".count");
+            llvm::IRBuilder<> entry(&function->getEntryBlock(),
+                                    function->getEntryBlock().begin());
+            llvm::Value *count =
+                entry.CreateLoad(entry.getInt64Ty(), counter, "count");
+            entry.CreateStore(entry.CreateAdd(count, entry.getInt64(1)),
+                              counter);
         }
+
+        llvm::verifyFunction(*function, &llvm::errs());
+    }
+
+    Builder->ClearInsertionPoint();
+    body->eraseFromParent();
+    body = nullptr;
+    return function;
+}
+
+void Compiler::applyProfile(
+    const std::vector<std::pair<llvm::Function *, std::uint64_t>> &counts) {
+    std::vector<std::uint64_t> sorted;
+    std::uint64_t total = 0;
+    for (const auto &[function, count] : counts) {
+        function->setEntryCount(count);
+        sorted.push_back(count);
+        total += count;
     }
+    std::sort(sorted.rbegin(), sorted.rend());
+    // Counts that are all alike, as when every statement ran once, single
+    // nothing out; marking every function hot would only bias the inliner.
+    if (total == 0 || sorted.front() == sorted.back())
+        return;
+
+    // The smallest count among the hottest functions that together make up
+    // each cutoff (in millionths) of all calls, as llvm-profdata computes it.
+    static constexpr std::uint32_t cutoffs[] = {
+        10000,  100000, 200000, 300000, 400000, 500000, 600000, 700000,
+        800000, 900000, 950000, 990000, 999000, 999900, 999990, 999999};
+    llvm::SummaryEntryVector detailed;
+    std::size_t covered = 0;
+    std::uint64_t sum = 0;
+    for (std::uint32_t cutoff : cutoffs) {
+        auto needed = static_cast<std::uint64_t>(
+            static_cast<double>(total) * cutoff / 1000000);
+        while (covered < sorted.size() && (sum < needed || covered == 0))
+            sum += sorted[covered++];
+        detailed.push_back({cutoff, sorted[covered - 1], covered});
+    }
+
+    // ProfileSummaryInfo's default hot cutoff is 99%.
+    std::uint64_t hot = 0;
+    for (const llvm::ProfileSummaryEntry &entry : detailed)
+        if (entry.Cutoff == 990000)
+            hot = entry.MinCount;
+    for (const auto &[function, count] : counts) {
+        if (count == 0)
+            function->addFnAttr(llvm::Attribute::Cold);
+        else if (count >= hot)
+            function->addFnAttr(llvm::Attribute::Hot);
+    }
+
+    llvm::ProfileSummary summary(llvm::ProfileSummary::PSK_Instr, detailed,
+                                 total, sorted.front(), sorted.front(),
+                                 sorted.front(), sorted.size(),
+                                 sorted.size());
+    TheModule->setProfileSummary(summary.getMD(*TheContext),
+                                 llvm::ProfileSummary::PSK_Instr);
+}
+
+void Compiler::optimize(unsigned level, llvm::TargetMachine *machine) {
+    static constexpr const llvm::OptimizationLevel *levels[] = {
+        &llvm::OptimizationLevel::O0, &llvm::OptimizationLevel::O1,
+        &llvm::OptimizationLevel::O2, &llvm::OptimizationLevel::O3};
+    const llvm::OptimizationLevel &optimization = *levels[std::min(level, 3u)];
+
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+
+    llvm::PassBuilder PB(machine);
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    llvm::ModulePassManager MPM =
+        level == 0 ? PB.buildO0DefaultPipeline(optimization)
+                   : PB.buildPerModuleDefaultPipeline(optimization);
+    MPM.run(*TheModule, MAM);
+}
 
-    if (R->getType()->getTypeID() == llvm::Type::ArrayTyID) {
-        std::string str1 =
-            cast<llvm::ConstantDataArray>(R)->getAsString().str();
-        str1.pop_back();
-
-        if (L->getType()->getTypeID() == llvm::Type::ArrayTyID) {
-            auto str2 = cast<llvm::ConstantDataArray>(L)->getAsString().str();
-            str2.pop_back();
-            return llvm::ConstantDataArray::getString(*TheContext, str2 + str1);
-        } else if (L->getType()->getTypeID() == llvm::Type::DoubleTyID) {
-            std::stringstream ss;
-            ss << cast<llvm::ConstantFP>(L)->getValueAPF().convertToDouble()
-               << str1;
-            return llvm::ConstantDataArray::getString(*TheContext, ss.str());
-        } else if (L->getType()->getTypeID() == llvm::Type::IntegerTyID) {
-            std::stringstream ss;
-            ss << cast<llvm::ConstantInt>(L)->getSExtValue() << str1;
-            return llvm::ConstantDataArray::getString(*TheContext, ss.str());
-        } else {
-            return error(expr.op, "Invalid string concatenation.");
+llvm::orc::ThreadSafeModule Compiler::takeModule() {
+    llvm::orc::ThreadSafeModule module(std::move(TheModule),
+                                       std::move(TheContext));
+    reset();
+    return module;
+}
+
+void Compiler::reset() {
+    TheContext = std::make_unique<llvm::LLVMContext>();
+    TheModule = std::make_unique<llvm::Module>("toy", *TheContext);
+    Builder = std::make_unique<llvm::IRBuilder<>>(*TheContext);
+    variables.clear();
+
+    llvm::FastMathFlags flags;
+    flags.setFast(fastMath);
+    Builder->setFastMathFlags(flags);
+}
+
+llvm::Value *Compiler::codegen(const FlatAST &ast) {
+    std::vector<llvm::Value *> values;
+
+    for (FlatAST::Index node = 0; node < ast.size(); node++) {
+        switch (ast.kind(node)) {
+        case ExprKind::Binary: {
+            llvm::Value *R = values.back();
+            values.pop_back();
+            values.back() =
+                binary(ast.token(node), ast.type(ast.left(node)),
+                       ast.type(ast.right(node)), values.back(), R);
+            break;
+        }
+        case ExprKind::Declaration:
+            values.back() =
+                declare(ast.token(node), ast.slot(node),
+                        ast.type(ast.operand(node)), values.back());
+            break;
+        case ExprKind::Grouping:
+            break;
+        case ExprKind::Literal:
+            values.push_back(literal(ast.token(node)));
+            break;
+        case ExprKind::Unary:
+            values.back() = unary(ast.token(node),
+                                  ast.type(ast.operand(node)), values.back());
+            break;
+        case ExprKind::Variable:
+            values.push_back(variable(ast.slot(node), ast.type(node)));
+            break;
         }
     }
 
-    switch (expr.op.type) {
+    return values.back();
+}
+
+llvm::Value *Compiler::visit(const BinaryExpr &expr, llvm::Value *L,
+                             llvm::Value *R) {
+    return binary(expr.op, (*types)[expr.left], (*types)[expr.right], L, R);
+}
+
+llvm::Value *Compiler::visit(const DeclarationExpr &expr,
+                             llvm::Value *initializer) {
+    return declare(expr.name, expr.slot, (*types)[expr.initializer],
+                   initializer);
+}
+
+llvm::Value *Compiler::visit(const GroupingExpr &, llvm::Value *expression) {
+    return expression;
+}
+
+llvm::Value *Compiler::visit(const LiteralExpr &expr) {
+    return literal(expr.value);
+}
+
+llvm::Value *Compiler::visit(const UnaryExpr &expr, llvm::Value *right) {
+    return unary(expr.op, (*types)[expr.right], right);
+}
+
+llvm::Value *Compiler::visit(const VariableExpr &expr) {
+    return variable(expr.slot, (*types)[&expr]);
+}
+
+llvm::Constant *Compiler::global(llvm::ConstantDataArray *array) {
+    auto *string = new llvm::GlobalVariable(
+        *TheModule, array->getType(), true, llvm::GlobalValue::PrivateLinkage,
+        array, "str");
+    string->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    return llvm::ConstantExpr::getInBoundsGetElementPtr(
+        array->getType(), string,
+        llvm::ArrayRef<llvm::Constant *>{Builder->getInt32(0),
+                                         Builder->getInt32(0)});
+}
+
+llvm::FunctionCallee Compiler::runtime(const char *name, llvm::Type *result,
+                                       llvm::ArrayRef<llvm::Type *> params) {
+    llvm::FunctionCallee callee = TheModule->getOrInsertFunction(
+        name, llvm::FunctionType::get(result, params, false));
+    auto *function = llvm::cast<llvm::Function>(callee.getCallee());
+    // C passes a bool zero-extended.
+    for (unsigned i = 0; i < params.size(); i++)
+        if (params[i]->isIntegerTy(1))
+            function->addParamAttr(i, llvm::Attribute::ZExt);
+    return callee;
+}
+
+// An operand of a concatenation that cannot be folded, as a runtime
+// string: literals are interned, numbers and booleans formatted.
+llvm::Value *Compiler::runtimeString(ValueType type, llvm::Value *value) {
+    llvm::Type *string = Builder->getInt8PtrTy();
+    switch (type) {
+    case ValueType::String: {
+        auto *array = llvm::dyn_cast<llvm::ConstantDataArray>(value);
+        if (array == nullptr)
+            return value;
+        return Builder->CreateCall(
+            runtime("toy_string_literal", string,
+                    {string, Builder->getInt64Ty()}),
+            {global(array), Builder->getInt64(array->getNumElements() - 1)},
+            "literal");
+    }
+    case ValueType::Number:
+        return Builder->CreateCall(
+            runtime("toy_string_from_number", string, {Builder->getDoubleTy()}),
+            {value}, "text");
+    case ValueType::Integer:
+        return Builder->CreateCall(
+            runtime("toy_string_from_integer", string, {Builder->getInt64Ty()}),
+            {value}, "text");
+    default:
+        return Builder->CreateCall(
+            runtime("toy_string_from_bool", string, {Builder->getInt1Ty()}),
+            {value}, "text");
+    }
+}
+
+bool Compiler::isConstantText(llvm::Value *value) {
+    return llvm::isa<llvm::ConstantDataArray, llvm::ConstantFP,
+                     llvm::ConstantInt>(value);
+}
+
+// The text a constant operand contributes to a concatenation: a number as
+// an ostream prints it, and an integer or a boolean as its sign-extended
+// value (a boolean's i1 gives -1 or 0).
+std::string Compiler::text(ValueType type, llvm::Value *value) {
+    std::ostringstream text;
+    switch (type) {
+    case ValueType::String: {
+        std::string string =
+            cast<llvm::ConstantDataArray>(value)->getAsString().str();
+        string.pop_back();
+        return string;
+    }
+    case ValueType::Number:
+        text << cast<llvm::ConstantFP>(value)->getValueAPF().convertToDouble();
+        return text.str();
+    default:
+        text << cast<llvm::ConstantInt>(value)->getSExtValue();
+        return text.str();
+    }
+}
+
+// A string operand is either a constant array or, once a concatenation
+// has grown past ConstantStringLimit, a runtime string.
+llvm::Value *Compiler::binary(const Token &op, ValueType left,
+                              ValueType right, llvm::Value *L,
+                              llvm::Value *R) {
+    if (op.type == TokenType::PLUS &&
+        (left == ValueType::String || right == ValueType::String)) {
+        if (isConstantText(L) && isConstantText(R)) {
+            std::string string = text(left, L) + text(right, R);
+            if (string.size() <= ConstantStringLimit)
+                return llvm::ConstantDataArray::getString(*TheContext,
+                                                          string);
+        }
+        llvm::Type *string = Builder->getInt8PtrTy();
+        return Builder->CreateCall(
+            runtime("toy_string_concat", string, {string, string}),
+            {runtimeString(left, L), runtimeString(right, R)}, "cattmp");
+    }
+
+    if (left == ValueType::Bool) {
+        switch (op.type) {
+        case TokenType::AND:
+            return Builder->CreateAnd(L, R, "andtmp");
+        case TokenType::OR:
+            return Builder->CreateOr(L, R, "ortmp");
+        case TokenType::EQUAL_EQUAL:
+            return Builder->CreateICmpEQ(L, R, "cmptmp");
+        default:
+            return Builder->CreateICmpNE(L, R, "cmptmp");
+        }
+    }
+
+    // Two integers compare as integers, and the arithmetic they take stays
+    // in i64 (wrapping on overflow).
+    if (arithmeticType(op.type, left, right) == ValueType::Integer) {
+        switch (op.type) {
+        case TokenType::PLUS:
+            return Builder->CreateAdd(L, R, "addtmp");
+        case TokenType::MINUS:
+            return Builder->CreateSub(L, R, "subtmp");
+        case TokenType::STAR:
+            return Builder->CreateMul(L, R, "multmp");
+        case TokenType::GREATER:
+            return Builder->CreateICmpSGT(L, R, "cmptmp");
+        case TokenType::GREATER_EQUAL:
+            return Builder->CreateICmpSGE(L, R, "cmptmp");
+        case TokenType::LESS:
+            return Builder->CreateICmpSLT(L, R, "cmptmp");
+        case TokenType::LESS_EQUAL:
+            return Builder->CreateICmpSLE(L, R, "cmptmp");
+        case TokenType::EQUAL_EQUAL:
+            return Builder->CreateICmpEQ(L, R, "cmptmp");
+        default:
+            return Builder->CreateICmpNE(L, R, "cmptmp");
+        }
+    }
+
+    if (left == ValueType::Integer)
+        L = Builder->CreateSIToFP(L, Builder->getDoubleTy(), "promoted");
+    if (right == ValueType::Integer)
+        R = Builder->CreateSIToFP(R, Builder->getDoubleTy(), "promoted");
+
+    switch (op.type) {
     case TokenType::PLUS:
         return Builder->CreateFAdd(L, R, "addtmp");
     case TokenType::MINUS:
@@ -91,47 +395,88 @@ llvm::Value *Compiler::visit(BinaryExpr<llvm::Value *> &expr) {
     case TokenType::EQUAL_EQUAL:
         return Builder->CreateFCmpUEQ(L, R, "cmptmp");
     default:
-        return error(expr.op, "Invalid binary operator.");
+        return Builder->CreateFCmpUNE(L, R, "cmptmp");
     }
 }
 
-llvm::Value *Compiler::visit(GroupingExpr<llvm::Value *> &expr) {
-    return codegen(expr.expression);
+// How a variable of type is stored: strings (as runtime strings) and null
+// as pointers, everything else as itself.
+llvm::Type *Compiler::storage(ValueType type) {
+    switch (type) {
+    case ValueType::Number:
+        return Builder->getDoubleTy();
+    case ValueType::Integer:
+        return Builder->getInt64Ty();
+    case ValueType::Bool:
+        return Builder->getInt1Ty();
+    default:
+        return Builder->getInt8PtrTy();
+    }
 }
 
-llvm::Value *Compiler::visit(LiteralExpr<llvm::Value *> &expr) {
-    if (expr.value.type == TokenType::NUMBER) {
-        return llvm::ConstantFP::get(
-            *TheContext, llvm::APFloat(std::stod(expr.value.lexeme)));
-    }
+// The global behind the variable in slot, with exportVariables().
+static std::string exportedName(std::uint32_t slot) {
+    return "toy_var_" + std::to_string(slot);
+}
 
-    if (expr.value.type == TokenType::TRUE) {
-        return Builder->getInt1(true);
-    }
+// Stores value in a new internal global named after the variable, or an
+// exported one; a constant string is interned first, so that every string
+// variable holds a runtime string.
+llvm::Value *Compiler::declare(const Token &name, std::uint32_t slot,
+                               ValueType type, llvm::Value *value) {
+    if (type == ValueType::String)
+        value = runtimeString(type, value);
 
-    if (expr.value.type == TokenType::FALSE) {
-        return Builder->getInt1(false);
-    }
+    llvm::Type *stored = storage(type);
+    auto *global = new llvm::GlobalVariable(
+        *TheModule, stored, false,
+        exporting ? llvm::GlobalValue::ExternalLinkage
+                  : llvm::GlobalValue::InternalLinkage,
+        llvm::Constant::getNullValue(stored),
+        exporting ? exportedName(slot) : std::string(lexer.lexeme(name)));
+    if (slot >= variables.size())
+        variables.resize(slot + 1, nullptr);
+    variables[slot] = global;
 
-    if (expr.value.type == TokenType::STRING) {
-        return llvm::ConstantDataArray::getString(*TheContext,
-                                                  expr.value.lexeme);
-    }
+    Builder->CreateStore(value, global);
+    return value;
+}
 
-    return error(expr.value, "Invalid literal.");
+llvm::Value *Compiler::variable(std::uint32_t slot, ValueType type) {
+    if (slot >= variables.size())
+        variables.resize(slot + 1, nullptr);
+    llvm::GlobalVariable *&global = variables[slot];
+    if (global == nullptr)
+        global = new llvm::GlobalVariable(
+            *TheModule, storage(type), false,
+            llvm::GlobalValue::ExternalLinkage, nullptr, exportedName(slot));
+    return Builder->CreateLoad(storage(type), global, global->getName());
 }
 
-llvm::Value *Compiler::visit(UnaryExpr<llvm::Value *> &expr) {
-    llvm::Value *operand = codegen(expr.right);
-    if (operand == nullptr) {
-        return nullptr;
-    }
-    switch (expr.op.type) {
-    case TokenType::MINUS:
-        return Builder->CreateFNeg(operand, "negtmp");
-    case TokenType::BANG:
-        return Builder->CreateNot(operand, "nottmp");
+llvm::Value *Compiler::literal(const Token &value) {
+    switch (value.type) {
+    case TokenType::NUMBER:
+        return llvm::ConstantFP::get(
+            *TheContext, llvm::APFloat(lexer.literals().number(value)));
+    case TokenType::INTEGER:
+        return Builder->getInt64(lexer.literals().integer(value));
+    case TokenType::TRUE:
+        return Builder->getInt1(true);
+    case TokenType::FALSE:
+        return Builder->getInt1(false);
+    case TokenType::STRING:
+        return llvm::ConstantDataArray::getString(
+            *TheContext, lexer.literals().string(value));
     default:
-        return error(expr.op, "invalid unary operator.");
+        return llvm::ConstantPointerNull::get(Builder->getInt8PtrTy());
     }
-}
\ No newline at end of file
+}
+
+llvm::Value *Compiler::unary(const Token &op, ValueType type,
+                             llvm::Value *operand) {
+    if (op.type == TokenType::MINUS && type == ValueType::Integer)
+        return Builder->CreateNeg(operand, "negtmp");
+    if (op.type == TokenType::MINUS)
+        return Builder->CreateFNeg(operand, "negtmp");
+    return Builder->CreateNot(operand, "nottmp");
+}
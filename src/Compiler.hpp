@@ -8,30 +8,119 @@
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Target/TargetMachine.h>
 
 #include "Expr.hpp"
+#include "FlatAST.hpp"
+#include "Lexer.hpp"
 #include "Token.hpp"
-#include "ToyLang.hpp"
 
-#include <map>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+// Generates code for one source from trees annotated by TypeChecker, one
+// instruction sequence per node chosen by the types it was given; a tree
+// that failed to check must not be passed in. Concatenations are folded
+// into constants up to ConstantStringLimit and call the string runtime
+// (Runtime.hpp) beyond it. Each variable is a global of the module,
+// found by its slot; a string variable holds a runtime string. Every
+// Compiler owns its
+// LLVMContext, module and builder, so compilers on different threads never
+// share LLVM state.
 class Compiler : public ExprVisitor<llvm::Value *> {
   private:
-    static std::unique_ptr<llvm::LLVMContext> TheContext;
-    static std::unique_ptr<llvm::Module> TheModule;
-    static std::unique_ptr<llvm::IRBuilder<>> Builder;
-    static std::map<std::string, llvm::Value *> NamedValues;
+    std::unique_ptr<llvm::LLVMContext> TheContext;
+    std::unique_ptr<llvm::Module> TheModule;
+    std::unique_ptr<llvm::IRBuilder<>> Builder;
+
+    Lexer &lexer;
+    bool fastMath;
+    bool profiling = false;
+    bool exporting = false;
+    llvm::Function *body = nullptr;
+    // Those of the tree being generated.
+    const ExprTypes *types = nullptr;
+    // By slot; nullptr for declarations not compiled into this module.
+    std::vector<llvm::GlobalVariable *> variables;
 
   public:
-    llvm::Value *error(Token token, std::string message);
-    llvm::Value *codegen(std::unique_ptr<Expr<llvm::Value *>> &expr);
+    // With fastMath, floating-point instructions carry every fast-math flag
+    // (reassociation, no NaNs or infinities, ...), so the optimizer may
+    // reorder and vectorize them at the cost of IEEE-exact results.
+    Compiler(Lexer &lexer, bool fastMath = false);
+
+    // types holds what TypeChecker recorded for expr.
+    llvm::Value *codegen(const Expr *expr, const ExprTypes &types);
+    llvm::Value *codegen(const FlatAST &ast);
+
+    // Code generated between begin() and finish() goes into a function
+    // `name` with no parameters that returns value of the checked type (a
+    // string comes back as a pointer to its characters, null as a null
+    // pointer). With type Unknown, for a declaration, the function returns
+    // nothing. finish() returns nullptr and discards the code if value is
+    // nullptr.
+    void begin();
+    llvm::Function *finish(const std::string &name, ValueType type,
+                           llvm::Value *value);
+
+    // Makes every function finish() creates count its calls in an i64
+    // global named <name>.count, for --profile-generate.
+    void instrument(bool enabled) { profiling = enabled; }
+
+    // Makes every variable an external global named toy_var_<slot>, and
+    // declares one this module uses but does not define, so that modules
+    // compiled from sources sharing their slots (see Parser) link up.
+    void exportVariables(bool enabled) { exporting = enabled; }
+
+    // Attaches measured call counts for --profile-use: entry counts, hot
+    // and cold attributes, and a module profile summary, from which the
+    // optimizer's ProfileSummaryInfo decides what is hot. Counts that are
+    // all equal get entry counts only.
+    void applyProfile(
+        const std::vector<std::pair<llvm::Function *, std::uint64_t>> &counts);
+
+    // Runs the new pass manager's default pipeline for -O<level> over the
+    // module built so far; level 0 only runs the mandatory passes. With a
+    // target machine the pipeline also uses its cost model.
+    void optimize(unsigned level, llvm::TargetMachine *machine = nullptr);
+
+    // Hands the module built so far, with its context, to the caller (the
+    // JIT) and starts empty ones.
+    llvm::orc::ThreadSafeModule takeModule();
+    llvm::Module &module() { return *TheModule; }
+
+    llvm::Value *visit(const BinaryExpr &expr, llvm::Value *L,
+                       llvm::Value *R) override;
+    llvm::Value *visit(const DeclarationExpr &expr,
+                       llvm::Value *initializer) override;
+    llvm::Value *visit(const GroupingExpr &expr,
+                       llvm::Value *expression) override;
+    llvm::Value *visit(const LiteralExpr &expr) override;
+    llvm::Value *visit(const UnaryExpr &expr, llvm::Value *right) override;
+    llvm::Value *visit(const VariableExpr &expr) override;
+
+  private:
+    void reset();
 
-    llvm::Value *visit(BinaryExpr<llvm::Value *> &expr) override;
-    llvm::Value *visit(GroupingExpr<llvm::Value *> &expr) override;
-    llvm::Value *visit(LiteralExpr<llvm::Value *> &expr) override;
-    llvm::Value *visit(UnaryExpr<llvm::Value *> &expr) override;
+    llvm::Constant *global(llvm::ConstantDataArray *array);
+    llvm::FunctionCallee runtime(const char *name, llvm::Type *result,
+                                 llvm::ArrayRef<llvm::Type *> params);
+    llvm::Value *runtimeString(ValueType type, llvm::Value *value);
+    static bool isConstantText(llvm::Value *value);
+    std::string text(ValueType type, llvm::Value *value);
+    llvm::Type *storage(ValueType type);
+    llvm::Value *binary(const Token &op, ValueType left, ValueType right,
+                        llvm::Value *L, llvm::Value *R);
+    llvm::Value *declare(const Token &name, std::uint32_t slot,
+                         ValueType type, llvm::Value *value);
+    llvm::Value *literal(const Token &value);
+    llvm::Value *unary(const Token &op, ValueType type,
+                       llvm::Value *operand);
+    llvm::Value *variable(std::uint32_t slot, ValueType type);
 };
 
 #endif
\ No newline at end of file
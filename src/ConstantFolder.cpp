@@ -0,0 +1,380 @@
+#include "ConstantFolder.hpp"
+#include "Parser.hpp"
+#include "Runtime.hpp"
+
+#include <cmath>
+#include <sstream>
+
+// Integer arithmetic wraps like the i64 instructions codegen emits.
+static std::int64_t wrap(std::uint64_t value) {
+    return static_cast<std::int64_t>(value);
+}
+
+const Expr *ConstantFolder::fold(const Expr *expr) {
+    return expr->accept(*this).expr;
+}
+
+Folded ConstantFolder::visit(const BinaryExpr &expr, Folded left,
+                             Folded right) {
+    TokenType op = expr.op.type;
+
+    if (isConstant(left) && isConstant(right)) {
+        if (auto folded = evaluate(op, left, right))
+            return *folded;
+    }
+
+    if (auto simplified = simplify(op, left, right))
+        return *simplified;
+
+    ValueType type = ValueType::Unknown;
+    if (left.type == ValueType::String || right.type == ValueType::String) {
+        if (op == TokenType::PLUS)
+            type = ValueType::String;
+    } else if (op == TokenType::AND || op == TokenType::OR)
+        type = ValueType::Bool;
+    else if (isNumeric(left.type) && isNumeric(right.type))
+        type = Parser::infixPrecedence(op) == Precedence::Term ||
+                       Parser::infixPrecedence(op) == Precedence::Factor
+                   ? arithmeticType(op, left.type, right.type)
+                   : ValueType::Bool;
+    else if (left.type == ValueType::Bool && right.type == ValueType::Bool &&
+             Parser::infixPrecedence(op) == Precedence::Equality)
+        type = ValueType::Bool;
+
+    const Expr *result = &expr;
+    if (left.expr != expr.left || right.expr != expr.right)
+        result = arena.make<BinaryExpr>(left.expr, expr.op, right.expr);
+    return {result, type, left.begin, right.end};
+}
+
+Folded ConstantFolder::visit(const DeclarationExpr &expr,
+                             Folded initializer) {
+    const Expr *result = &expr;
+    if (initializer.expr != expr.initializer)
+        result = arena.make<DeclarationExpr>(expr.name, expr.slot,
+                                             initializer.expr);
+    return {result, initializer.type, expr.name.pos, initializer.end};
+}
+
+Folded ConstantFolder::visit(const GroupingExpr &, Folded expression) {
+    return expression;
+}
+
+Folded ConstantFolder::visit(const LiteralExpr &expr) {
+    ValueType type = ValueType::Unknown;
+    switch (expr.value.type) {
+    case TokenType::NUMBER:
+        type = ValueType::Number;
+        break;
+    case TokenType::INTEGER:
+        type = ValueType::Integer;
+        break;
+    case TokenType::STRING:
+        type = ValueType::String;
+        break;
+    case TokenType::TRUE:
+    case TokenType::FALSE:
+        type = ValueType::Bool;
+        break;
+    case TokenType::NIL:
+        type = ValueType::Null;
+        break;
+    default:
+        break;
+    }
+    return {&expr, type, expr.value.pos, expr.value.pos + expr.value.len};
+}
+
+Folded ConstantFolder::visit(const UnaryExpr &expr, Folded right) {
+    std::uint32_t begin = expr.op.pos;
+
+    if (expr.op.type == TokenType::MINUS && isNumeric(right.type)) {
+        if (isConstant(right) && right.type == ValueType::Integer)
+            return constant(wrap(0 - std::uint64_t(integer(right))), begin,
+                            right.end);
+        if (isConstant(right))
+            return constant(-number(right), begin, right.end);
+        if (right.expr->kind == ExprKind::Unary &&
+            static_cast<const UnaryExpr &>(*right.expr).op.type ==
+                TokenType::MINUS)
+            return {static_cast<const UnaryExpr &>(*right.expr).right,
+                    right.type, begin, right.end};
+    }
+
+    if (expr.op.type == TokenType::BANG && right.type == ValueType::Bool) {
+        if (isConstant(right))
+            return constant(!boolean(right), begin, right.end);
+        if (right.expr->kind == ExprKind::Unary &&
+            static_cast<const UnaryExpr &>(*right.expr).op.type ==
+                TokenType::BANG)
+            return {static_cast<const UnaryExpr &>(*right.expr).right,
+                    ValueType::Bool, begin, right.end};
+    }
+
+    ValueType type = ValueType::Unknown;
+    if (expr.op.type == TokenType::MINUS && isNumeric(right.type))
+        type = right.type;
+    else if (expr.op.type == TokenType::BANG && right.type == ValueType::Bool)
+        type = ValueType::Bool;
+
+    const Expr *result = &expr;
+    if (right.expr != expr.right)
+        result = arena.make<UnaryExpr>(expr.op, right.expr);
+    return {result, type, begin, right.end};
+}
+
+Folded ConstantFolder::visit(const VariableExpr &expr) {
+    return {&expr, ValueType::Unknown, expr.name.pos,
+            expr.name.pos + expr.name.len};
+}
+
+// Mirrors Compiler::binary on two constants; nullopt where codegen would
+// report an error.
+std::optional<Folded> ConstantFolder::evaluate(TokenType op,
+                                               const Folded &left,
+                                               const Folded &right) {
+    std::uint32_t begin = left.begin, end = right.end;
+
+    if (left.type == ValueType::String || right.type == ValueType::String) {
+        if (op != TokenType::PLUS)
+            return std::nullopt;
+        auto l = concatOperand(left), r = concatOperand(right);
+        if (!l || !r || l->size() + r->size() > ConstantStringLimit)
+            return std::nullopt;
+        return constant(*l + *r, begin, end);
+    }
+
+    if (op == TokenType::AND || op == TokenType::OR) {
+        if (left.type != ValueType::Bool || right.type != ValueType::Bool)
+            return std::nullopt;
+        bool value = op == TokenType::AND ? boolean(left) && boolean(right)
+                                          : boolean(left) || boolean(right);
+        return constant(value, begin, end);
+    }
+
+    if (left.type == ValueType::Bool && right.type == ValueType::Bool) {
+        if (op == TokenType::EQUAL_EQUAL)
+            return constant(boolean(left) == boolean(right), begin, end);
+        if (op == TokenType::BANG_EQUAL)
+            return constant(boolean(left) != boolean(right), begin, end);
+        return std::nullopt;
+    }
+
+    if (!isNumeric(left.type) || !isNumeric(right.type))
+        return std::nullopt;
+
+    if (arithmeticType(op, left.type, right.type) == ValueType::Integer) {
+        std::int64_t l = integer(left), r = integer(right);
+        switch (op) {
+        case TokenType::PLUS:
+            return constant(wrap(std::uint64_t(l) + r), begin, end);
+        case TokenType::MINUS:
+            return constant(wrap(std::uint64_t(l) - r), begin, end);
+        case TokenType::STAR:
+            return constant(wrap(std::uint64_t(l) * r), begin, end);
+        case TokenType::GREATER:
+            return constant(l > r, begin, end);
+        case TokenType::GREATER_EQUAL:
+            return constant(l >= r, begin, end);
+        case TokenType::LESS:
+            return constant(l < r, begin, end);
+        case TokenType::LESS_EQUAL:
+            return constant(l <= r, begin, end);
+        case TokenType::EQUAL_EQUAL:
+            return constant(l == r, begin, end);
+        case TokenType::BANG_EQUAL:
+            return constant(l != r, begin, end);
+        default:
+            return std::nullopt;
+        }
+    }
+
+    double l = number(left), r = number(right);
+    bool unordered = std::isnan(l) || std::isnan(r);
+    switch (op) {
+    case TokenType::PLUS:
+        return constant(l + r, begin, end);
+    case TokenType::MINUS:
+        return constant(l - r, begin, end);
+    case TokenType::STAR:
+        return constant(l * r, begin, end);
+    case TokenType::SLASH:
+        return constant(l / r, begin, end);
+    case TokenType::GREATER:
+        return constant(unordered || l > r, begin, end);
+    case TokenType::GREATER_EQUAL:
+        return constant(unordered || l >= r, begin, end);
+    case TokenType::LESS:
+        return constant(unordered || l < r, begin, end);
+    case TokenType::LESS_EQUAL:
+        return constant(unordered || l <= r, begin, end);
+    case TokenType::EQUAL_EQUAL:
+        return constant(unordered || l == r, begin, end);
+    case TokenType::BANG_EQUAL:
+        return constant(unordered || l != r, begin, end);
+    default:
+        return std::nullopt;
+    }
+}
+
+std::optional<Folded> ConstantFolder::simplify(TokenType op,
+                                               const Folded &left,
+                                               const Folded &right) {
+    auto keep = [&](const Folded &operand) -> std::optional<Folded> {
+        return Folded{operand.expr, operand.type, left.begin, right.end};
+    };
+
+    if (left.type == ValueType::Number && right.type == ValueType::Number) {
+        switch (op) {
+        case TokenType::STAR:
+            if (isNumber(right, 1))
+                return keep(left);
+            if (isNumber(left, 1))
+                return keep(right);
+            break;
+        case TokenType::SLASH:
+            if (isNumber(right, 1))
+                return keep(left);
+            break;
+        case TokenType::MINUS:
+            if (isNumber(right, 0))
+                return keep(left);
+            break;
+        case TokenType::PLUS:
+            if (isNumber(right, -0.0))
+                return keep(left);
+            if (isNumber(left, -0.0))
+                return keep(right);
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (left.type == ValueType::Integer && right.type == ValueType::Integer) {
+        switch (op) {
+        case TokenType::STAR:
+            if (isInteger(right, 1))
+                return keep(left);
+            if (isInteger(left, 1))
+                return keep(right);
+            break;
+        case TokenType::MINUS:
+            if (isInteger(right, 0))
+                return keep(left);
+            break;
+        case TokenType::PLUS:
+            if (isInteger(right, 0))
+                return keep(left);
+            if (isInteger(left, 0))
+                return keep(right);
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (left.type == ValueType::Bool && right.type == ValueType::Bool) {
+        bool identity = op == TokenType::AND;
+        if (op == TokenType::AND || op == TokenType::OR) {
+            if (isBool(right, identity))
+                return keep(left);
+            if (isBool(left, identity))
+                return keep(right);
+        }
+    }
+
+    return std::nullopt;
+}
+
+// The text a constant contributes to a concatenation, formatted the way
+// Compiler::binary formats it.
+std::optional<std::string>
+ConstantFolder::concatOperand(const Folded &operand) const {
+    std::ostringstream text;
+    switch (operand.type) {
+    case ValueType::String:
+        return std::string(lexer.literals().string(
+            static_cast<const LiteralExpr &>(*operand.expr).value));
+    case ValueType::Number:
+        text << number(operand);
+        return text.str();
+    case ValueType::Integer:
+        text << integer(operand);
+        return text.str();
+    case ValueType::Bool:
+        text << (boolean(operand) ? -1 : 0);
+        return text.str();
+    default:
+        return std::nullopt;
+    }
+}
+
+bool ConstantFolder::isConstant(const Folded &operand) const {
+    return operand.expr->kind == ExprKind::Literal &&
+           operand.type != ValueType::Unknown;
+}
+
+// Matches the sign of zero as well, since x + 0 is not x for x = -0.
+bool ConstantFolder::isNumber(const Folded &operand, double value) const {
+    return isConstant(operand) && operand.type == ValueType::Number &&
+           number(operand) == value &&
+           std::signbit(number(operand)) == std::signbit(value);
+}
+
+bool ConstantFolder::isInteger(const Folded &operand,
+                               std::int64_t value) const {
+    return isConstant(operand) && operand.type == ValueType::Integer &&
+           integer(operand) == value;
+}
+
+bool ConstantFolder::isBool(const Folded &operand, bool value) const {
+    return isConstant(operand) && operand.type == ValueType::Bool &&
+           boolean(operand) == value;
+}
+
+// An integer constant is promoted, as codegen promotes it.
+double ConstantFolder::number(const Folded &operand) const {
+    if (operand.type == ValueType::Integer)
+        return static_cast<double>(integer(operand));
+    return lexer.literals().number(
+        static_cast<const LiteralExpr &>(*operand.expr).value);
+}
+
+std::int64_t ConstantFolder::integer(const Folded &operand) const {
+    return lexer.literals().integer(
+        static_cast<const LiteralExpr &>(*operand.expr).value);
+}
+
+bool ConstantFolder::boolean(const Folded &operand) const {
+    return static_cast<const LiteralExpr &>(*operand.expr).value.type ==
+           TokenType::TRUE;
+}
+
+Folded ConstantFolder::constant(double value, std::uint32_t begin,
+                                std::uint32_t end) {
+    Token token(TokenType::NUMBER, begin, end - begin,
+                lexer.literals().addNumber(value));
+    return {arena.make<LiteralExpr>(token), ValueType::Number, begin, end};
+}
+
+Folded ConstantFolder::constant(std::int64_t value, std::uint32_t begin,
+                                std::uint32_t end) {
+    Token token(TokenType::INTEGER, begin, end - begin,
+                lexer.literals().addInteger(value));
+    return {arena.make<LiteralExpr>(token), ValueType::Integer, begin, end};
+}
+
+Folded ConstantFolder::constant(bool value, std::uint32_t begin,
+                                std::uint32_t end) {
+    Token token(value ? TokenType::TRUE : TokenType::FALSE, begin,
+                end - begin);
+    return {arena.make<LiteralExpr>(token), ValueType::Bool, begin, end};
+}
+
+Folded ConstantFolder::constant(std::string value, std::uint32_t begin,
+                                std::uint32_t end) {
+    Token token(TokenType::STRING, begin, end - begin,
+                lexer.literals().addString(std::move(value)));
+    return {arena.make<LiteralExpr>(token), ValueType::String, begin, end};
+}
@@ -0,0 +1,73 @@
+#ifndef TOYLANG_CONSTANTFOLDER_HPP
+#define TOYLANG_CONSTANTFOLDER_HPP
+
+#include "Arena.hpp"
+#include "Expr.hpp"
+#include "Lexer.hpp"
+#include "Token.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// A subtree after folding, with its value type and the source range it
+// came from (folded literals point their token at that range).
+struct Folded {
+    const Expr *expr;
+    ValueType type;
+    std::uint32_t begin;
+    std::uint32_t end;
+};
+
+// Evaluates constant subexpressions on the tree before codegen, with the
+// same semantics Compiler gives them: IEEE doubles with unordered
+// comparisons, wrapping i64 integers promoted to doubles where they meet
+// one or under /, and a + of a string with anything (a number, or a
+// boolean as its sign-extended i1) concatenating. Also drops groupings and
+// removes identities that hold exactly (x*1, 1*x, x/1, x-0, x+(-0) on
+// doubles, the same with 0 on integers, --x, !!b, b and true, b or
+// false). Concatenations longer than ConstantStringLimit are left to the
+// string runtime, as codegen leaves them, and variables are not constants
+// (their type is not known here). Anything codegen would reject
+// is left in place for it to report. Folded numbers and strings are added
+// to the Lexer's LiteralTable.
+class ConstantFolder : public ExprVisitor<Folded> {
+  public:
+    // New nodes are allocated from arena; untouched subtrees are shared.
+    ConstantFolder(Lexer &lexer, Arena &arena) : lexer(lexer), arena(arena) {}
+
+    const Expr *fold(const Expr *expr);
+
+    Folded visit(const BinaryExpr &expr, Folded left, Folded right) override;
+    Folded visit(const DeclarationExpr &expr, Folded initializer) override;
+    Folded visit(const GroupingExpr &expr, Folded expression) override;
+    Folded visit(const LiteralExpr &expr) override;
+    Folded visit(const UnaryExpr &expr, Folded right) override;
+    Folded visit(const VariableExpr &expr) override;
+
+  private:
+    Lexer &lexer;
+    Arena &arena;
+
+    std::optional<Folded> evaluate(TokenType op, const Folded &left,
+                                   const Folded &right);
+    std::optional<Folded> simplify(TokenType op, const Folded &left,
+                                   const Folded &right);
+    std::optional<std::string> concatOperand(const Folded &operand) const;
+
+    bool isConstant(const Folded &operand) const;
+    bool isNumber(const Folded &operand, double value) const;
+    bool isInteger(const Folded &operand, std::int64_t value) const;
+    bool isBool(const Folded &operand, bool value) const;
+    double number(const Folded &operand) const;
+    std::int64_t integer(const Folded &operand) const;
+    bool boolean(const Folded &operand) const;
+
+    Folded constant(double value, std::uint32_t begin, std::uint32_t end);
+    Folded constant(std::int64_t value, std::uint32_t begin,
+                    std::uint32_t end);
+    Folded constant(bool value, std::uint32_t begin, std::uint32_t end);
+    Folded constant(std::string value, std::uint32_t begin, std::uint32_t end);
+};
+
+#endif
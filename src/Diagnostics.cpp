@@ -0,0 +1,102 @@
+#include "Diagnostics.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+void Diagnostics::report(std::uint32_t line, std::uint32_t pos,
+                         std::uint32_t len, std::string where,
+                         std::string message) {
+    diagnostics.push_back(
+        {line, pos, len, std::move(where), std::move(message)});
+}
+
+void Diagnostics::absorb(Diagnostics &other, std::string file) {
+    if (other.diagnostics.empty())
+        return;
+
+    std::uint32_t index = 0;
+    if (!file.empty()) {
+        files.push_back(std::move(file));
+        index = files.size();
+    }
+    for (Diagnostic &diagnostic : other.diagnostics) {
+        diagnostic.file = index;
+        diagnostics.push_back(std::move(diagnostic));
+    }
+    other.diagnostics.clear();
+}
+
+static void appendJsonString(std::string &out, const std::string &text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escape[8];
+                std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+                out += escape;
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+void Diagnostics::flush(std::ostream &out, DiagnosticFormat format) {
+    if (diagnostics.empty() && format == DiagnosticFormat::Human)
+        return;
+
+    // Lexing, parsing and codegen report in their own passes; print in
+    // source order.
+    std::stable_sort(diagnostics.begin(), diagnostics.end(),
+                     [](const Diagnostic &a, const Diagnostic &b) {
+                         return a.file != b.file ? a.file < b.file
+                                                 : a.pos < b.pos;
+                     });
+
+    std::string text;
+    if (format == DiagnosticFormat::Json) {
+        text += '[';
+        for (std::size_t i = 0; i < diagnostics.size(); i++) {
+            const Diagnostic &d = diagnostics[i];
+            text += i == 0 ? "{" : ",{";
+            if (d.file != 0) {
+                text += "\"file\":";
+                appendJsonString(text, files[d.file - 1]);
+                text += ',';
+            }
+            text += "\"line\":" + std::to_string(d.line);
+            text += ",\"pos\":" + std::to_string(d.pos);
+            text += ",\"len\":" + std::to_string(d.len);
+            text += ",\"message\":";
+            appendJsonString(text, d.message);
+            text += '}';
+        }
+        text += "]\n";
+    } else {
+        for (const Diagnostic &d : diagnostics) {
+            if (d.file != 0)
+                text += files[d.file - 1] + ": ";
+            text += "[line " + std::to_string(d.line) + "] Error" + d.where +
+                    ": " + d.message + "\n";
+        }
+    }
+
+    out.write(text.data(), text.size());
+    out.flush();
+    diagnostics.clear();
+    files.clear();
+}
@@ -0,0 +1,48 @@
+#ifndef TOYLANG_DIAGNOSTICS_HPP
+#define TOYLANG_DIAGNOSTICS_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct Diagnostic {
+    std::uint32_t line;
+    std::uint32_t pos; // byte offset into the source
+    std::uint32_t len;
+    std::string where; // " at 'lexeme'", " at end" or empty
+    std::string message;
+    std::uint32_t file = 0; // 1-based index into Diagnostics' files, or 0
+};
+
+enum class DiagnosticFormat : std::uint8_t { Human, Json };
+
+// Collects every error of a run instead of printing each one as it is
+// found, then writes them all with a single flush, either as the classic
+// "[line N] Error at 'x': message" lines or as a JSON array.
+class Diagnostics {
+  public:
+    void report(std::uint32_t line, std::uint32_t pos, std::uint32_t len,
+                std::string where, std::string message);
+
+    bool empty() const { return diagnostics.empty(); }
+    std::size_t size() const { return diagnostics.size(); }
+    const Diagnostic &operator[](std::size_t i) const {
+        return diagnostics[i];
+    }
+
+    // Moves everything other holds into this buffer, tagged with file
+    // unless it is empty, so the errors of many sources can be written with
+    // one flush.
+    void absorb(Diagnostics &other, std::string file);
+
+    // Writes everything reported so far in source order (file by file),
+    // then drops it.
+    void flush(std::ostream &out, DiagnosticFormat format);
+
+  private:
+    std::vector<Diagnostic> diagnostics;
+    std::vector<std::string> files;
+};
+
+#endif
@@ -1,69 +1,258 @@
 #ifndef TOYLANG_AST_HPP
 #define TOYLANG_AST_HPP
 
-#include <memory>
-#include <string>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Token.hpp"
 
-template <typename T> class ExprVisitor;
+template <typename R> class ExprVisitor;
 
-template <typename T> class Expr {
-  public:
-    virtual ~Expr() = default;
-    virtual T accept(class ExprVisitor<T> &visitor) = 0;
+enum class ExprKind : std::uint8_t {
+    Binary,
+    Declaration,
+    Grouping,
+    Literal,
+    Unary,
+    Variable
+};
+
+// What is statically known about the value of a subtree. A Number is a
+// double and an Integer an i64.
+enum class ValueType : std::uint8_t {
+    Unknown,
+    Number,
+    Integer,
+    Bool,
+    String,
+    Null
 };
 
-template <typename T> class BinaryExpr : public Expr<T> {
+inline bool isNumeric(ValueType type) {
+    return type == ValueType::Number || type == ValueType::Integer;
+}
+
+// The type +, -, * and / give two numeric operands: integers stay integers
+// except under /, and anything else is promoted to a double.
+inline ValueType arithmeticType(TokenType op, ValueType left,
+                                ValueType right) {
+    return left == ValueType::Integer && right == ValueType::Integer &&
+                   op != TokenType::SLASH
+               ? ValueType::Integer
+               : ValueType::Number;
+}
+
+// One tree type serves every pass: visitors pick their own return type and
+// walk the tree read-only, so a single parse can be printed, analyzed and
+// compiled. Nodes are allocated from the parse's Arena and refer to their
+// children with plain pointers; they are never destroyed one by one, so
+// they must stay trivially destructible. What a pass infers about a node
+// goes beside the tree (see ExprTypes), never into it.
+class Expr {
   public:
-    BinaryExpr(std::unique_ptr<Expr<T>> left, Token op,
-               std::unique_ptr<Expr<T>> right)
-        : left(std::move(left)), op(op), right(std::move(right)) {}
+    const ExprKind kind;
+    // Reachable along more than one path; see ExprBuilder.
+    bool shared = false;
 
-    virtual T accept(ExprVisitor<T> &visitor) { return visitor.visit(*this); }
+    template <typename R> R accept(ExprVisitor<R> &visitor) const;
 
-    std::unique_ptr<Expr<T>> left;
-    Token op;
-    std::unique_ptr<Expr<T>> right;
+  protected:
+    explicit Expr(ExprKind kind) : kind(kind) {}
 };
 
-template <typename T> class GroupingExpr : public Expr<T> {
+class BinaryExpr : public Expr {
   public:
-    GroupingExpr(std::unique_ptr<Expr<T>> expression)
-        : expression(std::move(expression)) {}
+    BinaryExpr(const Expr *left, Token op, const Expr *right)
+        : Expr(ExprKind::Binary), left(left), op(op), right(right) {}
+
+    const Expr *left;
+    Token op;
+    const Expr *right;
+};
 
-    virtual T accept(ExprVisitor<T> &visitor) { return visitor.visit(*this); }
+// var name = initializer; only ever the root of a statement. The parser
+// gives every declaration a slot of its own (see SymbolTable).
+class DeclarationExpr : public Expr {
+  public:
+    DeclarationExpr(Token name, std::uint32_t slot, const Expr *initializer)
+        : Expr(ExprKind::Declaration), name(name), slot(slot),
+          initializer(initializer) {}
 
-    std::unique_ptr<Expr<T>> expression;
+    Token name;
+    std::uint32_t slot;
+    const Expr *initializer;
 };
 
-template <typename T> class LiteralExpr : public Expr<T> {
+class GroupingExpr : public Expr {
   public:
-    LiteralExpr(Token value) : value(value) {}
+    GroupingExpr(const Expr *expression)
+        : Expr(ExprKind::Grouping), expression(expression) {}
+
+    const Expr *expression;
+};
 
-    virtual T accept(ExprVisitor<T> &visitor) { return visitor.visit(*this); }
+class LiteralExpr : public Expr {
+  public:
+    LiteralExpr(Token value) : Expr(ExprKind::Literal), value(value) {}
 
     Token value;
 };
 
-template <typename T> class UnaryExpr : public Expr<T> {
+class UnaryExpr : public Expr {
   public:
-    UnaryExpr(Token op, std::unique_ptr<Expr<T>> right)
-        : op(op), right(std::move(right)) {}
-
-    virtual T accept(ExprVisitor<T> &visitor) { return visitor.visit(*this); }
+    UnaryExpr(Token op, const Expr *right)
+        : Expr(ExprKind::Unary), op(op), right(right) {}
 
     Token op;
-    std::unique_ptr<Expr<T>> right;
+    const Expr *right;
+};
+
+// A use of a variable, resolved by the parser to its declaration's slot.
+class VariableExpr : public Expr {
+  public:
+    VariableExpr(Token name, std::uint32_t slot)
+        : Expr(ExprKind::Variable), name(name), slot(slot) {}
+
+    Token name;
+    std::uint32_t slot;
+};
+
+// The type TypeChecker inferred for each node of the trees it checked, by
+// node. The table belongs to whoever runs the checker, so a node shared
+// between trees (see ExprBuilder) may be typed in several contexts without
+// any of them seeing another's types.
+class ExprTypes {
+  public:
+    // Unknown for a node that was not checked or has an error.
+    ValueType operator[](const Expr *expr) const {
+        auto it = types.find(expr);
+        return it == types.end() ? ValueType::Unknown : it->second;
+    }
+
+    ValueType set(const Expr &expr, ValueType type) {
+        return types[&expr] = type;
+    }
+
+  private:
+    std::unordered_map<const Expr *, ValueType> types;
 };
 
-template <typename T> class ExprVisitor {
+// Visitors see each node after its children, together with the results
+// already computed for them. Expr::accept drives the walk with an explicit
+// stack, so no visitor recurses and any depth of tree is safe. A shared
+// node is visited once per walk and its result reused everywhere else, unless
+// the visitor needs to see every path.
+template <typename R> class ExprVisitor {
   public:
-    virtual T visit(BinaryExpr<T> &expr) = 0;
-    virtual T visit(GroupingExpr<T> &expr) = 0;
-    virtual T visit(LiteralExpr<T> &expr) = 0;
-    virtual T visit(UnaryExpr<T> &expr) = 0;
+    virtual bool reuseShared() const { return true; }
+
+    virtual R visit(const BinaryExpr &expr, R left, R right) = 0;
+    virtual R visit(const DeclarationExpr &expr, R initializer) = 0;
+    virtual R visit(const GroupingExpr &expr, R expression) = 0;
+    virtual R visit(const LiteralExpr &expr) = 0;
+    virtual R visit(const UnaryExpr &expr, R right) = 0;
+    virtual R visit(const VariableExpr &expr) = 0;
 };
 
-#endif
\ No newline at end of file
+template <typename R> R Expr::accept(ExprVisitor<R> &visitor) const {
+    // Enter schedules a node's children, Exit visits it once they are
+    // walked and Memoize records a shared node's result.
+    enum Step : std::uint8_t { Enter, Exit, Memoize };
+
+    // Pending steps, and the results of walked nodes whose parent has not
+    // been visited yet.
+    std::vector<std::pair<const Expr *, Step>> work = {{this, Enter}};
+    std::vector<R> results;
+    std::unordered_map<const Expr *, R> memo;
+    const bool reuse = visitor.reuseShared();
+
+    auto pop = [&results] {
+        R result = std::move(results.back());
+        results.pop_back();
+        return result;
+    };
+
+    while (!work.empty()) {
+        auto [expr, step] = work.back();
+        work.pop_back();
+
+        if (step == Memoize) {
+            memo.emplace(expr, results.back());
+            continue;
+        }
+
+        if (step == Enter && expr->shared && reuse) {
+            if (auto it = memo.find(expr); it != memo.end()) {
+                results.push_back(it->second);
+                continue;
+            }
+            work.push_back({expr, Memoize});
+        }
+
+        bool expanded = step == Exit;
+        switch (expr->kind) {
+        case ExprKind::Binary: {
+            auto &binary = static_cast<const BinaryExpr &>(*expr);
+            if (!expanded) {
+                work.push_back({expr, Exit});
+                work.push_back({binary.right, Enter});
+                work.push_back({binary.left, Enter});
+                break;
+            }
+            R right = pop();
+            R left = pop();
+            results.push_back(
+                visitor.visit(binary, std::move(left), std::move(right)));
+            break;
+        }
+        case ExprKind::Declaration: {
+            auto &declaration = static_cast<const DeclarationExpr &>(*expr);
+            if (!expanded) {
+                work.push_back({expr, Exit});
+                work.push_back({declaration.initializer, Enter});
+                break;
+            }
+            R initializer = pop();
+            results.push_back(
+                visitor.visit(declaration, std::move(initializer)));
+            break;
+        }
+        case ExprKind::Grouping: {
+            auto &grouping = static_cast<const GroupingExpr &>(*expr);
+            if (!expanded) {
+                work.push_back({expr, Exit});
+                work.push_back({grouping.expression, Enter});
+                break;
+            }
+            R expression = pop();
+            results.push_back(visitor.visit(grouping, std::move(expression)));
+            break;
+        }
+        case ExprKind::Literal:
+            results.push_back(
+                visitor.visit(static_cast<const LiteralExpr &>(*expr)));
+            break;
+        case ExprKind::Unary: {
+            auto &unary = static_cast<const UnaryExpr &>(*expr);
+            if (!expanded) {
+                work.push_back({expr, Exit});
+                work.push_back({unary.right, Enter});
+                break;
+            }
+            R right = pop();
+            results.push_back(visitor.visit(unary, std::move(right)));
+            break;
+        }
+        case ExprKind::Variable:
+            results.push_back(
+                visitor.visit(static_cast<const VariableExpr &>(*expr)));
+            break;
+        }
+    }
+
+    return pop();
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include "ExprBuilder.hpp"
+
+#include <bit>
+
+std::size_t ExprBuilder::KeyHash::operator()(const Key &key) const {
+    std::uint64_t hash = key.first * 0x9e3779b97f4a7c15ull;
+    hash ^= key.second + 0x632be59bd9b4e019ull + (hash << 6) + (hash >> 2);
+    hash ^= static_cast<std::uint64_t>(key.kind) << 8 |
+            static_cast<std::uint64_t>(key.type);
+    return hash * 0xff51afd7ed558ccdull;
+}
+
+template <typename T, typename... Args>
+const Expr *ExprBuilder::intern(const Key &key, Args &&...args) {
+    auto [it, inserted] = nodesByKey.try_emplace(key, nullptr);
+    if (!inserted)
+        return reuse(it->second);
+    it->second = make<T>(std::forward<Args>(args)...);
+    return it->second;
+}
+
+static std::uint64_t address(const Expr *expr) {
+    return reinterpret_cast<std::uintptr_t>(expr);
+}
+
+const Expr *ExprBuilder::binary(const Expr *left, const Token &op,
+                                const Expr *right) {
+    if (!hashCons)
+        return make<BinaryExpr>(left, op, right);
+    return intern<BinaryExpr>(
+        {address(left), address(right), ExprKind::Binary, op.type}, left, op,
+        right);
+}
+
+const Expr *ExprBuilder::declaration(const Token &name, std::uint32_t slot,
+                                     const Expr *initializer) {
+    return make<DeclarationExpr>(name, slot, initializer);
+}
+
+const Expr *ExprBuilder::grouping(const Expr *expression) {
+    if (!hashCons)
+        return make<GroupingExpr>(expression);
+    return intern<GroupingExpr>(
+        {address(expression), 0, ExprKind::Grouping, TokenType::LEFT_PAREN},
+        expression);
+}
+
+const Expr *ExprBuilder::literal(const Token &value) {
+    if (!hashCons)
+        return make<LiteralExpr>(value);
+
+    if (value.type == TokenType::STRING) {
+        auto [it, inserted] = stringsByValue.try_emplace(
+            lexer.literals().string(value), nullptr);
+        if (!inserted)
+            return reuse(it->second);
+        it->second = make<LiteralExpr>(value);
+        return it->second;
+    }
+
+    std::uint64_t bits = 0;
+    if (value.type == TokenType::NUMBER)
+        bits = std::bit_cast<std::uint64_t>(lexer.literals().number(value));
+    else if (value.type == TokenType::INTEGER)
+        bits = std::bit_cast<std::uint64_t>(lexer.literals().integer(value));
+    return intern<LiteralExpr>({bits, 0, ExprKind::Literal, value.type}, value);
+}
+
+const Expr *ExprBuilder::unary(const Token &op, const Expr *right) {
+    if (!hashCons)
+        return make<UnaryExpr>(op, right);
+    return intern<UnaryExpr>(
+        {address(right), 0, ExprKind::Unary, op.type}, op, right);
+}
+
+const Expr *ExprBuilder::variable(const Token &name, std::uint32_t slot) {
+    if (!hashCons)
+        return make<VariableExpr>(name, slot);
+    return intern<VariableExpr>(
+        {slot, 0, ExprKind::Variable, TokenType::IDENTIFIER}, name, slot);
+}
@@ -0,0 +1,76 @@
+#ifndef TOYLANG_EXPRBUILDER_HPP
+#define TOYLANG_EXPRBUILDER_HPP
+
+#include "Arena.hpp"
+#include "Expr.hpp"
+#include "Lexer.hpp"
+#include "Token.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+// Creates Expr nodes in an Arena. With hash-consing on, structurally
+// identical subtrees are built once and handed out again, so repetitive
+// input parses into a DAG whose size follows the number of distinct
+// subexpressions. A reused node keeps the tokens of its first occurrence
+// and is marked shared, so that Expr::accept visits it only once.
+class ExprBuilder {
+  public:
+    ExprBuilder(const Lexer &lexer, Arena &arena, bool hashCons = false)
+        : lexer(lexer), arena(arena), hashCons(hashCons) {}
+
+    const Expr *binary(const Expr *left, const Token &op, const Expr *right);
+    // Declarations are statements and never shared.
+    const Expr *declaration(const Token &name, std::uint32_t slot,
+                            const Expr *initializer);
+    const Expr *grouping(const Expr *expression);
+    const Expr *literal(const Token &value);
+    const Expr *unary(const Token &op, const Expr *right);
+    const Expr *variable(const Token &name, std::uint32_t slot);
+
+    // Nodes built so far, and how many requests were answered by reuse.
+    std::size_t nodes() const { return built; }
+    std::size_t reused() const { return hits; }
+
+  private:
+    // Children are interned before their parents, so two nodes are equal
+    // when their kind, operator and child pointers are; literals compare
+    // by value and variables by slot.
+    struct Key {
+        std::uint64_t first;
+        std::uint64_t second;
+        ExprKind kind;
+        TokenType type;
+
+        bool operator==(const Key &other) const = default;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const;
+    };
+
+    const Lexer &lexer;
+    Arena &arena;
+    bool hashCons;
+    std::size_t built = 0;
+    std::size_t hits = 0;
+    std::unordered_map<Key, Expr *, KeyHash> nodesByKey;
+    std::unordered_map<std::string_view, Expr *> stringsByValue;
+
+    template <typename T, typename... Args> Expr *make(Args &&...args) {
+        built++;
+        return arena.make<T>(std::forward<Args>(args)...);
+    }
+
+    Expr *reuse(Expr *node) {
+        hits++;
+        node->shared = true;
+        return node;
+    }
+
+    template <typename T, typename... Args>
+    const Expr *intern(const Key &key, Args &&...args);
+};
+
+#endif
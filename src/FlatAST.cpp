@@ -0,0 +1,66 @@
+#include "FlatAST.hpp"
+
+FlatAST::Index FlatAST::add(const Expr &expr, ValueType type,
+                            const Token *token, Index left) {
+    kinds.push_back(expr.kind);
+    types.push_back(type);
+    lefts.push_back(left);
+    if (token == nullptr) {
+        tokenIndices.push_back(None);
+    } else {
+        tokenIndices.push_back(tokens.size());
+        tokens.push_back(*token);
+    }
+    return root();
+}
+
+FlatAST FlatAST::flatten(const Expr *root, const ExprTypes &types) {
+    // accept() hands each node over right after its children, which is
+    // exactly the order the arrays are laid out in.
+    struct Flattener : ExprVisitor<Index> {
+        FlatAST &ast;
+        const ExprTypes &types;
+        Flattener(FlatAST &ast, const ExprTypes &types)
+            : ast(ast), types(types) {}
+
+        // The layout needs every occurrence of a shared node in place.
+        bool reuseShared() const override { return false; }
+
+        Index visit(const BinaryExpr &expr, Index left, Index) override {
+            return ast.add(expr, types[&expr], &expr.op, left);
+        }
+        Index visit(const DeclarationExpr &expr, Index) override {
+            return ast.add(expr, types[&expr], &expr.name, expr.slot);
+        }
+        Index visit(const GroupingExpr &expr, Index) override {
+            return ast.add(expr, types[&expr], nullptr, None);
+        }
+        Index visit(const LiteralExpr &expr) override {
+            return ast.add(expr, types[&expr], &expr.value, None);
+        }
+        Index visit(const UnaryExpr &expr, Index) override {
+            return ast.add(expr, types[&expr], &expr.op, None);
+        }
+        Index visit(const VariableExpr &expr) override {
+            return ast.add(expr, types[&expr], &expr.name, expr.slot);
+        }
+    };
+
+    FlatAST ast;
+    Flattener flattener(ast, types);
+    root->accept(flattener);
+
+    ast.kinds.shrink_to_fit();
+    ast.types.shrink_to_fit();
+    ast.tokenIndices.shrink_to_fit();
+    ast.lefts.shrink_to_fit();
+    ast.tokens.shrink_to_fit();
+    return ast;
+}
+
+std::size_t FlatAST::bytes() const {
+    return kinds.capacity() * sizeof(ExprKind) +
+           types.capacity() * sizeof(ValueType) +
+           tokenIndices.capacity() * sizeof(Index) +
+           lefts.capacity() * sizeof(Index) + tokens.capacity() * sizeof(Token);
+}
@@ -0,0 +1,53 @@
+#ifndef TOYLANG_FLATAST_HPP
+#define TOYLANG_FLATAST_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "Expr.hpp"
+#include "Token.hpp"
+
+// Structure-of-arrays encoding of an Expr tree in post-order: every node
+// comes after its children and the root is last, so a pass can walk it as a
+// single loop over the arrays with a value stack instead of chasing
+// pointers through accept(). Per node it stores a one-byte kind, the
+// one-byte type TypeChecker gave it, a 32-bit index into its own compacted
+// token array, and for binary nodes the 32-bit index of the left child
+// (for variables and declarations, their slot); the right child (or only
+// child) is always the previous node.
+class FlatAST {
+  public:
+    using Index = std::uint32_t;
+    static constexpr Index None = UINT32_MAX;
+
+    // Flattens root without recursion, so any depth of tree is fine. Nodes
+    // missing from types are Unknown.
+    static FlatAST flatten(const Expr *root,
+                           const ExprTypes &types = ExprTypes());
+
+    Index size() const { return kinds.size(); }
+    Index root() const { return size() - 1; }
+
+    ExprKind kind(Index node) const { return kinds[node]; }
+    ValueType type(Index node) const { return types[node]; }
+    const Token &token(Index node) const { return tokens[tokenIndices[node]]; }
+    Index left(Index node) const { return lefts[node]; }
+    std::uint32_t slot(Index node) const { return lefts[node]; }
+    Index right(Index node) const { return node - 1; }
+    Index operand(Index node) const { return node - 1; }
+
+    // Bytes held by the encoding, for comparison with the Arena tree.
+    std::size_t bytes() const;
+
+  private:
+    std::vector<ExprKind> kinds;
+    std::vector<ValueType> types;
+    std::vector<Index> tokenIndices;
+    std::vector<Index> lefts;
+    std::vector<Token> tokens;
+
+    Index add(const Expr &expr, ValueType type, const Token *token,
+              Index left);
+};
+
+#endif
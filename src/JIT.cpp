@@ -0,0 +1,59 @@
+#include "JIT.hpp"
+#include "ObjectEmitter.hpp"
+#include "Runtime.hpp"
+
+#include <llvm/ExecutionEngine/Orc/Core.h>
+
+llvm::ExitOnError JIT::ExitOnErr("ToyLang JIT: ");
+
+JIT::JIT() {
+    ObjectEmitter::initializeTargets();
+
+    jit = ExitOnErr(llvm::orc::LLJITBuilder().create());
+
+    // The runtime is linked into this process; generated code finds it by
+    // name.
+    auto symbol = [](auto *function) {
+        return llvm::JITEvaluatedSymbol(
+            llvm::pointerToJITTargetAddress(function),
+            llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+    };
+    llvm::orc::SymbolMap runtime;
+    runtime[jit->mangleAndIntern("toy_string_literal")] =
+        symbol(&toy_string_literal);
+    runtime[jit->mangleAndIntern("toy_string_from_number")] =
+        symbol(&toy_string_from_number);
+    runtime[jit->mangleAndIntern("toy_string_from_integer")] =
+        symbol(&toy_string_from_integer);
+    runtime[jit->mangleAndIntern("toy_string_from_bool")] =
+        symbol(&toy_string_from_bool);
+    runtime[jit->mangleAndIntern("toy_string_concat")] =
+        symbol(&toy_string_concat);
+    runtime[jit->mangleAndIntern("toy_string_data")] =
+        symbol(&toy_string_data);
+    ExitOnErr(jit->getMainJITDylib().define(
+        llvm::orc::absoluteSymbols(std::move(runtime))));
+}
+
+void JIT::add(llvm::orc::ThreadSafeModule module) {
+    module.withModuleDo(
+        [this](llvm::Module &m) { m.setDataLayout(jit->getDataLayout()); });
+    ExitOnErr(jit->addIRModule(std::move(module)));
+}
+
+llvm::orc::ResourceTrackerSP
+JIT::addTracked(llvm::orc::ThreadSafeModule module) {
+    module.withModuleDo(
+        [this](llvm::Module &m) { m.setDataLayout(jit->getDataLayout()); });
+    auto tracker = jit->getMainJITDylib().createResourceTracker();
+    ExitOnErr(jit->addIRModule(tracker, std::move(module)));
+    return tracker;
+}
+
+void JIT::remove(llvm::orc::ResourceTrackerSP tracker) {
+    ExitOnErr(tracker->remove());
+}
+
+void JIT::add(std::unique_ptr<llvm::MemoryBuffer> object) {
+    ExitOnErr(jit->addObjectFile(std::move(object)));
+}
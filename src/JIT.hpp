@@ -0,0 +1,43 @@
+#ifndef TOYLANG_JIT_HPP
+#define TOYLANG_JIT_HPP
+
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <memory>
+#include <string>
+
+// ORC LLJIT for the host CPU. A module added to it is compiled to native
+// code when one of its symbols is first looked up.
+class JIT {
+  public:
+    JIT();
+
+    void add(llvm::orc::ThreadSafeModule module);
+    // A relocatable object for the host, linked in as it is.
+    void add(std::unique_ptr<llvm::MemoryBuffer> object);
+
+    // Adds module under a tracker of its own. Removing the tracker frees
+    // the module's code and symbols and leaves everything else in place.
+    llvm::orc::ResourceTrackerSP addTracked(llvm::orc::ThreadSafeModule module);
+    void remove(llvm::orc::ResourceTrackerSP tracker);
+
+    // Address of a function compiled from an added module.
+    template <typename T> T *lookup(const std::string &name) {
+        auto symbol = ExitOnErr(jit->lookup(name));
+        return reinterpret_cast<T *>(symbol.getAddress());
+    }
+
+    const llvm::DataLayout &dataLayout() const {
+        return jit->getDataLayout();
+    }
+
+  private:
+    static llvm::ExitOnError ExitOnErr;
+
+    std::unique_ptr<llvm::orc::LLJIT> jit;
+};
+
+#endif
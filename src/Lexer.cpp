@@ -1,127 +1,361 @@
 #include "Lexer.hpp"
+#include "ByteScanner.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+
+namespace {
+
+// Lexical class of every byte; scanToken dispatches on this instead of on
+// the raw character.
+enum class CharClass : std::uint8_t {
+    Invalid,
+    Whitespace,
+    Digit,
+    Alpha,
+    Single,   // ( ) { } , . - + ; *
+    Operator, // ! = < >, optionally followed by '='
+    Slash,
+    Hash,
+    Quote,
+};
+
+struct CharInfo {
+    CharClass cls = CharClass::Invalid;
+    TokenType type = TokenType::END_OF_FILE;      // Single and Operator
+    TokenType withEqual = TokenType::END_OF_FILE; // Operator followed by '='
+};
+
+constexpr std::array<CharInfo, 256> charTable = [] {
+    std::array<CharInfo, 256> table{};
+    for (unsigned char c : {' ', '\t', '\r', '\n'})
+        table[c].cls = CharClass::Whitespace;
+    for (int c = '0'; c <= '9'; c++)
+        table[c].cls = CharClass::Digit;
+    for (int c = 'a'; c <= 'z'; c++)
+        table[c].cls = CharClass::Alpha;
+    for (int c = 'A'; c <= 'Z'; c++)
+        table[c].cls = CharClass::Alpha;
+    table['_'].cls = CharClass::Alpha;
+
+    auto single = [&](unsigned char c, TokenType type) {
+        table[c] = {CharClass::Single, type, type};
+    };
+    single('(', TokenType::LEFT_PAREN);
+    single(')', TokenType::RIGHT_PAREN);
+    single('{', TokenType::LEFT_BRACE);
+    single('}', TokenType::RIGHT_BRACE);
+    single(',', TokenType::COMMA);
+    single('.', TokenType::DOT);
+    single('-', TokenType::MINUS);
+    single('+', TokenType::PLUS);
+    single(';', TokenType::SEMICOLON);
+    single('*', TokenType::STAR);
+
+    auto op = [&](unsigned char c, TokenType type, TokenType withEqual) {
+        table[c] = {CharClass::Operator, type, withEqual};
+    };
+    op('!', TokenType::BANG, TokenType::BANG_EQUAL);
+    op('=', TokenType::EQUAL, TokenType::EQUAL_EQUAL);
+    op('<', TokenType::LESS, TokenType::LESS_EQUAL);
+    op('>', TokenType::GREATER, TokenType::GREATER_EQUAL);
+
+    table['/'] = {CharClass::Slash, TokenType::SLASH, TokenType::SLASH};
+    table['#'].cls = CharClass::Hash;
+    table['"'].cls = CharClass::Quote;
+    return table;
+}();
+
+const CharInfo &classify(char c) {
+    return charTable[static_cast<unsigned char>(c)];
+}
+
+struct Keyword {
+    std::string_view text;
+    TokenType type = TokenType::IDENTIFIER;
+};
+
+constexpr Keyword keywords[] = {
+    {"and", TokenType::AND},       {"class", TokenType::CLASS},
+    {"else", TokenType::ELSE},     {"false", TokenType::FALSE},
+    {"for", TokenType::FOR},       {"fun", TokenType::FUN},
+    {"if", TokenType::IF},         {"null", TokenType::NIL},
+    {"or", TokenType::OR},         {"print", TokenType::PRINT},
+    {"return", TokenType::RETURN}, {"super", TokenType::SUPER},
+    {"this", TokenType::THIS},     {"true", TokenType::TRUE},
+    {"var", TokenType::VAR},       {"while", TokenType::WHILE},
+};
+
+constexpr std::size_t keywordMinLength = 2;
+constexpr std::size_t keywordMaxLength = 6;
+
+// Collision-free over the keywords above; checked by the static_assert below.
+constexpr std::size_t keywordHash(std::string_view text) {
+    return (static_cast<unsigned char>(text.front()) +
+            5 * static_cast<unsigned char>(text.back()) + text.size()) &
+           31;
+}
+
+constexpr std::array<Keyword, 32> keywordTable = [] {
+    std::array<Keyword, 32> table{};
+    for (const Keyword &keyword : keywords)
+        table[keywordHash(keyword.text)] = keyword;
+    return table;
+}();
+
+constexpr bool keywordHashIsPerfect() {
+    for (const Keyword &keyword : keywords) {
+        if (keywordTable[keywordHash(keyword.text)].text != keyword.text)
+            return false;
+        if (keyword.text.size() < keywordMinLength ||
+            keyword.text.size() > keywordMaxLength)
+            return false;
+    }
+    return true;
+}
+
+static_assert(keywordHashIsPerfect(), "keyword hash has a collision");
+
+} // namespace
+
+std::string_view Lexer::lexeme(const Token &token) const {
+    if (token.type == TokenType::STRING)
+        return source.substr(token.pos + 1, token.len - 2);
+    return source.substr(token.pos, token.len);
+}
+
+int Lexer::line(const Token &token) const { return lineAt(token.pos); }
+
+int Lexer::lineAt(std::uint32_t offset) const {
+    if (lineStarts.empty()) {
+        const char *begin = source.data();
+        const char *end = begin + source.size();
+        lineStarts.reserve(ByteScanner::count(begin, end, '\n') + 1);
+        lineStarts.push_back(0);
+        for (const char *p = ByteScanner::find(begin, end, '\n'); p != end;
+             p = ByteScanner::find(p + 1, end, '\n'))
+            lineStarts.push_back(p + 1 - begin);
+    }
+
+    auto next = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+    return next - lineStarts.begin();
+}
+
+std::string Lexer::toString(const Token &token) const {
+    return std::string(name(token.type)) + " " + std::string(lexeme(token));
+}
+
+TokenType Lexer::keyword(std::string_view text) {
+    if (text.size() < keywordMinLength || text.size() > keywordMaxLength)
+        return TokenType::IDENTIFIER;
+
+    const Keyword &candidate = keywordTable[keywordHash(text)];
+    return candidate.text == text ? candidate.type : TokenType::IDENTIFIER;
+}
+
+Token Lexer::next() {
+    if (replayed < prescanned.size())
+        return prescanned[replayed++];
 
-std::vector<Token> Lexer::scanTokens() {
     while (!isAtEnd()) {
         start = current;
         scanToken();
+        if (produced) {
+            produced = false;
+            return std::move(token);
+        }
     }
 
-    tokens.push_back(
-        Token(TokenType::END_OF_FILE, std::string(""), current, 0, line));
+    return Token(TokenType::END_OF_FILE, current, 0);
+}
+
+std::vector<Token> Lexer::scanTokens() {
+    std::vector<Token> tokens;
+    // Generated sources average well over four bytes per token; reserving
+    // up front avoids repeatedly moving every token as the vector grows, and
+    // capacity that is never touched is never committed.
+    tokens.reserve(source.size() / 4 + 1);
+
+    do {
+        tokens.push_back(next());
+    } while (tokens.back().type != TokenType::END_OF_FILE);
+
     return tokens;
 }
 
+void Lexer::scanRange(std::uint32_t to, std::vector<Token> &out) {
+    while (current < to && !isAtEnd()) {
+        start = current;
+        scanToken();
+        if (produced) {
+            produced = false;
+            out.push_back(token);
+        }
+    }
+}
+
+namespace {
+
+struct Chunk {
+    std::uint32_t from = 0; // first loop head, whitespace already skipped
+    std::uint32_t to = 0;   // tokens must start before this
+    std::uint32_t exit = 0; // first loop head at or past `to`
+    std::vector<Token> tokens;
+    LiteralTable literals;
+    std::vector<std::pair<std::uint32_t, const char *>> errors;
+};
+
+} // namespace
+
+std::vector<Token> Lexer::scanTokens(ThreadPool &pool, std::size_t chunkSize) {
+    const char *begin = source.data();
+    const char *end = begin + source.size();
+
+    // Boundaries sit just after a newline, advanced past any whitespace so
+    // that a chunk starts where the previous one's whitespace run stops.
+    std::vector<Chunk> chunks;
+    std::uint32_t boundary = current;
+    while (boundary < source.size()) {
+        Chunk chunk;
+        chunk.from = boundary;
+        if (!chunks.empty())
+            chunk.from = ByteScanner::skipWhitespace(begin + boundary, end) -
+                         begin;
+
+        std::size_t limit = std::min<std::size_t>(boundary + chunkSize,
+                                                  source.size());
+        const char *newline = ByteScanner::find(begin + limit, end, '\n');
+        boundary = newline == end ? source.size() : newline + 1 - begin;
+        chunk.to = boundary;
+        chunks.push_back(std::move(chunk));
+    }
+
+    for (Chunk &chunk : chunks) {
+        pool.submit([this, &chunk] {
+            Lexer lexer(source);
+            lexer.current = chunk.from;
+            lexer.deferredErrors = &chunk.errors;
+            if (chunk.from < chunk.to)
+                chunk.tokens.reserve((chunk.to - chunk.from) / 4 + 1);
+            lexer.scanRange(chunk.to, chunk.tokens);
+            chunk.exit = lexer.current;
+            chunk.literals = std::move(lexer.literalTable);
+        });
+    }
+    pool.wait();
+
+    std::size_t total = 1;
+    for (const Chunk &chunk : chunks)
+        total += chunk.tokens.size();
+    std::vector<Token> tokens;
+    tokens.reserve(total);
+
+    // Merge in order. A chunk is valid when the lexing so far stopped exactly
+    // where it began; otherwise its range is re-lexed serially from there.
+    for (Chunk &chunk : chunks) {
+        if (current >= chunk.to)
+            continue; // a string or comment swallowed the whole chunk
+
+        if (current != chunk.from) {
+            Lexer lexer(source);
+            lexer.current = current;
+            lexer.deferredErrors = &chunk.errors;
+            chunk.tokens.clear();
+            chunk.errors.clear();
+            lexer.scanRange(chunk.to, chunk.tokens);
+            chunk.exit = lexer.current;
+            chunk.literals = std::move(lexer.literalTable);
+        }
+
+        std::uint32_t numberBase = literalTable.numberCount();
+        std::uint32_t integerBase = literalTable.integerCount();
+        std::uint32_t stringBase = literalTable.stringCount();
+        literalTable.append(chunk.literals);
+        // Chunks number their symbols privately; each distinct name is
+        // interned once here rather than once per use.
+        const SymbolInterner &symbols = chunk.literals.symbols();
+        std::vector<Symbol> symbolIds(symbols.size());
+        for (Symbol symbol = 0; symbol < symbols.size(); symbol++)
+            symbolIds[symbol] = literalTable.addSymbol(symbols.name(symbol));
+        for (Token token : chunk.tokens) {
+            if (token.type == TokenType::NUMBER)
+                token.literal += numberBase;
+            else if (token.type == TokenType::INTEGER)
+                token.literal += integerBase;
+            else if (token.type == TokenType::STRING)
+                token.literal += stringBase;
+            else if (token.type == TokenType::IDENTIFIER)
+                token.literal = symbolIds[token.literal];
+            tokens.push_back(token);
+        }
+
+        for (auto [offset, message] : chunk.errors)
+            error(offset, message);
+
+        current = chunk.exit;
+    }
+
+    tokens.push_back(Token(TokenType::END_OF_FILE, current, 0));
+    return tokens;
+}
+
+void Lexer::prescan(ThreadPool &pool) {
+    prescanned = scanTokens(pool);
+    replayed = 0;
+}
+
+void Lexer::error(std::uint32_t offset, const char *message) {
+    if (deferredErrors != nullptr)
+        deferredErrors->emplace_back(offset, message);
+    else
+        reported.report(lineAt(offset), offset, 1, "", message);
+}
+
+void Lexer::error(const Token &token, std::string message) {
+    std::string where = token.type == TokenType::END_OF_FILE
+                            ? " at end"
+                            : " at '" + std::string(lexeme(token)) + "'";
+    reported.report(line(token), token.pos, token.len, std::move(where),
+                    std::move(message));
+}
+
 void Lexer::scanToken() {
     char c = advance();
-    switch (c) {
-    case '(':
-        tokens.push_back(
-            Token(TokenType::LEFT_PAREN, std::string("("), current, 1, line));
-        break;
-    case ')':
-        tokens.push_back(
-            Token(TokenType::RIGHT_PAREN, std::string(")"), current, 1, line));
-        break;
-    case '{':
-        tokens.push_back(
-            Token(TokenType::LEFT_BRACE, std::string("{"), current, 1, line));
-        break;
-    case '}':
-        tokens.push_back(
-            Token(TokenType::RIGHT_BRACE, std::string("}"), current, 1, line));
-        break;
-    case ',':
-        tokens.push_back(
-            Token(TokenType::COMMA, std::string(","), current, 1, line));
-        break;
-    case '.':
-        tokens.push_back(
-            Token(TokenType::DOT, std::string("."), current, 1, line));
+    const CharInfo &info = classify(c);
+    switch (info.cls) {
+    case CharClass::Whitespace:
+        whitespace();
         break;
-    case '-':
-        tokens.push_back(
-            Token(TokenType::MINUS, std::string("-"), current, 1, line));
+    case CharClass::Digit:
+        number();
         break;
-    case '+':
-        tokens.push_back(
-            Token(TokenType::PLUS, std::string("+"), current, 1, line));
+    case CharClass::Alpha:
+        identifier();
         break;
-    case ';':
-        tokens.push_back(
-            Token(TokenType::SEMICOLON, std::string(";"), current, 1, line));
-        break;
-    case '*':
-        tokens.push_back(
-            Token(TokenType::STAR, std::string("*"), current, 1, line));
-        break;
-    case '!':
-        if (match('=')) {
-            tokens.push_back(Token(TokenType::BANG_EQUAL, std::string("!="),
-                                   current, 2, line));
-        } else {
-            tokens.push_back(
-                Token(TokenType::BANG, std::string("!"), current, 1, line));
-        }
-        break;
-    case '=':
-        if (match('=')) {
-            tokens.push_back(Token(TokenType::EQUAL_EQUAL, std::string("=="),
-                                   current, 2, line));
-        } else {
-            tokens.push_back(
-                Token(TokenType::EQUAL, std::string("="), current, 1, line));
-        }
-        break;
-    case '<':
-        if (match('=')) {
-            tokens.push_back(Token(TokenType::LESS_EQUAL, std::string("<="),
-                                   current, 2, line));
-        } else {
-            tokens.push_back(
-                Token(TokenType::LESS, std::string("<"), current, 1, line));
-        }
+    case CharClass::Single:
+        addToken(info.type);
         break;
-    case '>':
-        if (match('=')) {
-            tokens.push_back(Token(TokenType::GREATER_EQUAL, std::string(">="),
-                                   current, 2, line));
-        } else {
-            tokens.push_back(
-                Token(TokenType::GREATER, std::string(">"), current, 1, line));
-        }
+    case CharClass::Operator:
+        addToken(match('=') ? info.withEqual : info.type);
         break;
-    case '/':
-        if (match('/')) {
-            while (!isAtEnd() && peek() != '\n')
-                advance();
-        } else if (match('*')) {
+    case CharClass::Slash:
+        if (match('/'))
+            lineComment();
+        else if (match('*'))
             blockComment();
-        } else {
-            tokens.push_back(
-                Token(TokenType::SLASH, std::string("/"), current, 1, line));
-        }
-        break;
-    case '#':
-        while (!isAtEnd() && peek() != '\n')
-            advance();
-        break;
-    case ' ':
-    case '\r':
-    case '\t':
+        else
+            addToken(TokenType::SLASH);
         break;
-    case '\n':
-        line++;
+    case CharClass::Hash:
+        lineComment();
         break;
-    case '"':
+    case CharClass::Quote:
         string();
         break;
-    default:
-        if (isDigit(c))
-            number();
-        else if (isAlpha(c))
-            identifier();
-        else
-            ToyLang::error(current, "Unexpected character.");
+    case CharClass::Invalid:
+        error(start, "Unexpected character.");
         break;
     }
 }
@@ -130,19 +364,6 @@ bool Lexer::isAtEnd() const { return current >= source.length(); }
 
 char Lexer::advance() { return source[current++]; }
 
-char Lexer::peek() const {
-    if (isAtEnd())
-        return '\0';
-
-    return source[current];
-}
-
-char Lexer::peekNext() const {
-    if (isAtEnd())
-        return '\0';
-    return source[current + 1];
-}
-
 bool Lexer::match(char expected) {
     if (isAtEnd())
         return false;
@@ -153,75 +374,97 @@ bool Lexer::match(char expected) {
     return true;
 }
 
+void Lexer::addToken(TokenType type, std::uint32_t literal) {
+    token = Token(type, start, current - start, literal);
+    produced = true;
+}
+
+void Lexer::whitespace() {
+    const char *begin = source.data() + start;
+    const char *end = source.data() + source.size();
+    current = ByteScanner::skipWhitespace(begin, end) - source.data();
+}
+
+void Lexer::lineComment() {
+    const char *end = source.data() + source.size();
+    current = ByteScanner::find(source.data() + current, end, '\n') -
+              source.data();
+}
+
 void Lexer::string() {
-    while (peek() != '"' && !isAtEnd()) {
-        if (peek() == '\n')
-            line++;
-        advance();
-    }
+    const char *body = source.data() + current;
+    const char *end = source.data() + source.size();
+    current = ByteScanner::find(body, end, '"') - source.data();
 
     if (isAtEnd()) {
-        ToyLang::error(line, "Unterminated string");
+        error(current, "Unterminated string");
         return;
     }
 
     advance(); // closing "
 
-    std::string value = source.substr(start + 1, current - start - 2);
-
-    tokens.push_back(
-        Token(TokenType::STRING, value, current, current - start, line));
+    std::string_view value = source.substr(start + 1, current - start - 2);
+    addToken(TokenType::STRING, literalTable.addString(value));
 }
 
+// A literal without a fraction is an i64 if it fits and a double if not.
 void Lexer::number() {
-    while (isDigit(peek()))
-        advance();
+    while (!isAtEnd() && isDigit(source[current]))
+        current++;
 
-    if (peek() == '.' && isDigit(peekNext())) {
-        advance();
+    if (current + 1 < source.size() && source[current] == '.' &&
+        isDigit(source[current + 1])) {
+        current++;
 
-        while (isDigit(peek()))
-            advance();
+        while (!isAtEnd() && isDigit(source[current]))
+            current++;
+    } else {
+        std::int64_t value = 0;
+        if (std::from_chars(source.data() + start, source.data() + current,
+                            value)
+                .ec == std::errc()) {
+            addToken(TokenType::INTEGER, literalTable.addInteger(value));
+            return;
+        }
     }
 
-    std::string value = source.substr(start, current - start);
-    tokens.push_back(
-        Token(TokenType::NUMBER, value, current, current - start, line));
+    double value = 0;
+    std::from_chars(source.data() + start, source.data() + current, value);
+    addToken(TokenType::NUMBER, literalTable.addNumber(value));
 }
 
 void Lexer::identifier() {
-    while (isAlphaNumeric(peek()))
-        advance();
+    while (!isAtEnd() && isAlphaNumeric(source[current]))
+        current++;
 
-    std::string text = source.substr(start, current - start);
-
-    TokenType type = TokenType::IDENTIFIER;
-    if (keywords.find(text) != keywords.end())
-        type = keywords[text];
-
-    tokens.push_back(Token(type, text, current, current - start, line));
+    std::string_view text = source.substr(start, current - start);
+    TokenType type = keyword(text);
+    addToken(type, type == TokenType::IDENTIFIER ? literalTable.addSymbol(text)
+                                                 : 0);
 }
 
 void Lexer::blockComment() {
-    while (!isAtEnd() && peek() != '*' && peekNext() != '/') {
-        if (peek() == '\n')
-            line++;
-        advance();
-    }
+    const char *body = source.data() + current;
+    const char *end = source.data() + source.size();
+    const char *star = ByteScanner::find(body, end, '*');
+    while (star != end && (star + 1 == end || star[1] != '/'))
+        star = ByteScanner::find(star + 1, end, '*');
+
+    current = star - source.data();
 
     if (isAtEnd()) {
-        ToyLang::error(line, "Unterminated comment");
+        error(current, "Unterminated comment");
         return;
     }
 
-    advance(); // closing *
-    advance(); // closing /
+    current += 2; // closing */
 }
 
-bool Lexer::isDigit(char c) const { return c >= '0' && c <= '9'; }
-
-bool Lexer::isAlpha(char c) const {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+bool Lexer::isDigit(char c) const {
+    return classify(c).cls == CharClass::Digit;
 }
 
-bool Lexer::isAlphaNumeric(char c) const { return isAlpha(c) || isDigit(c); }
\ No newline at end of file
+bool Lexer::isAlphaNumeric(char c) const {
+    CharClass cls = classify(c).cls;
+    return cls == CharClass::Alpha || cls == CharClass::Digit;
+}
@@ -1,51 +1,101 @@
 #ifndef TOYLANG_LEXER_HPP
 #define TOYLANG_LEXER_HPP
 
-#include <map>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "Diagnostics.hpp"
+#include "LiteralTable.hpp"
+#include "ThreadPool.hpp"
 #include "Token.hpp"
-#include "ToyLang.hpp"
 
 class Lexer {
   public:
-    Lexer(const std::string &source) : source(source) {}
+    // The lexer borrows source; it must outlive the returned tokens' use.
+    Lexer(std::string_view source) : source(source) {}
 
+    // Scans and returns the next token. Once the source is exhausted every
+    // call returns END_OF_FILE.
+    Token next();
+
+    // Scans the whole source at once. Prefer next() (or a TokenCursor) for
+    // large inputs; this materializes every token.
     std::vector<Token> scanTokens();
 
+    // Same tokens, literal indices and errors as scanTokens(), but the source
+    // is split into chunks at newlines and the chunks are lexed concurrently.
+    // A chunk may begin inside a string or block comment; each chunk is lexed
+    // speculatively and any chunk whose starting point turns out to be wrong
+    // is re-lexed from the right offset while merging.
+    std::vector<Token> scanTokens(ThreadPool &pool,
+                                  std::size_t chunkSize = DefaultChunkSize);
+
+    // Runs the parallel scan up front; next() then replays its tokens.
+    void prescan(ThreadPool &pool);
+
+    static constexpr std::size_t DefaultChunkSize = 1 << 20;
+
+    // Keyword type for text, or IDENTIFIER. Uses a compile-time perfect hash.
+    static TokenType keyword(std::string_view text);
+
+    // Source text of token; the body without quotes for a STRING.
+    std::string_view lexeme(const Token &token) const;
+
+    // 1-based line of token. The line index is built on first use, so
+    // error-free runs never pay for it.
+    int line(const Token &token) const;
+    int lineAt(std::uint32_t offset) const;
+
+    // Type name and lexeme, e.g. "NUMBER 1.5".
+    std::string toString(const Token &token) const;
+
+    const LiteralTable &literals() const { return literalTable; }
+    LiteralTable &literals() { return literalTable; }
+
+    // Every error found in this source, by the lexer or any later pass.
+    Diagnostics &diagnostics() { return reported; }
+    const Diagnostics &diagnostics() const { return reported; }
+
+    // Reports message at token, quoting its lexeme.
+    void error(const Token &token, std::string message);
+
   private:
-    const std::string source;
-    std::vector<Token> tokens;
-    std::map<std::string, TokenType> keywords = {
-        {"and", TokenType::AND},       {"class", TokenType::CLASS},
-        {"else", TokenType::ELSE},     {"false", TokenType::FALSE},
-        {"for", TokenType::FOR},       {"fun", TokenType::FUN},
-        {"if", TokenType::IF},         {"null", TokenType::NIL},
-        {"or", TokenType::OR},         {"print", TokenType::PRINT},
-        {"return", TokenType::RETURN}, {"super", TokenType::SUPER},
-        {"this", TokenType::THIS},     {"true", TokenType::TRUE},
-        {"var", TokenType::VAR},       {"while", TokenType::WHILE},
-    };
-
-    int start = 0;
-    int current = 0;
-    int line = 1;
+    const std::string_view source;
+    LiteralTable literalTable;
+    Diagnostics reported;
+    mutable std::vector<std::uint32_t> lineStarts;
+    Token token;
+    bool produced = false;
+
+    std::uint32_t start = 0;
+    std::uint32_t current = 0;
+
+    // Set for chunk lexers, which must hold errors back until the merge
+    // knows whether their chunk was lexed from a valid starting point.
+    std::vector<std::pair<std::uint32_t, const char *>> *deferredErrors =
+        nullptr;
+
+    std::vector<Token> prescanned;
+    std::size_t replayed = 0;
 
     void scanToken();
+    void scanRange(std::uint32_t to, std::vector<Token> &out);
+    void error(std::uint32_t offset, const char *message);
 
     bool isAtEnd() const;
     char advance();
-    char peek() const;
-    char peekNext() const;
     bool match(char expected);
+    void addToken(TokenType type, std::uint32_t literal = 0);
+    void whitespace();
+    void lineComment();
     void string();
     void number();
     void identifier();
     void blockComment();
     bool isDigit(char c) const;
-    bool isAlpha(char c) const;
     bool isAlphaNumeric(char c) const;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,86 @@
+#ifndef TOYLANG_LITERALTABLE_HPP
+#define TOYLANG_LITERALTABLE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "SymbolTable.hpp"
+#include "Token.hpp"
+
+// Decoded payloads of NUMBER, INTEGER and STRING tokens, filled by the
+// Lexer and looked up through Token::literal; each kind has its own index
+// space. Strings are views into the source,
+// except those computed later (by constant folding), which the table owns.
+// An IDENTIFIER's literal is its symbol, interned here or, after
+// shareSymbols(), in an interner several tables share.
+class LiteralTable {
+  public:
+    std::uint32_t addNumber(double value) {
+        numbers.push_back(value);
+        return numbers.size() - 1;
+    }
+
+    std::uint32_t addInteger(std::int64_t value) {
+        integers.push_back(value);
+        return integers.size() - 1;
+    }
+
+    std::uint32_t addString(std::string_view value) {
+        strings.push_back(value);
+        return strings.size() - 1;
+    }
+
+    std::uint32_t addString(std::string &&value) {
+        return addString(std::string_view(owned.emplace_back(std::move(value))));
+    }
+
+    Symbol addSymbol(std::string_view name) { return symbols().intern(name); }
+
+    // Interns into symbols from now on; call before adding any.
+    void shareSymbols(SymbolInterner &symbols) { shared = &symbols; }
+
+    double number(const Token &token) const { return numbers[token.literal]; }
+    std::int64_t integer(const Token &token) const {
+        return integers[token.literal];
+    }
+
+    std::string_view string(const Token &token) const {
+        return strings[token.literal];
+    }
+
+    const SymbolInterner &symbols() const {
+        return shared != nullptr ? *shared : interner;
+    }
+    SymbolInterner &symbols() {
+        return shared != nullptr ? *shared : interner;
+    }
+
+    std::uint32_t numberCount() const { return numbers.size(); }
+    std::uint32_t integerCount() const { return integers.size(); }
+    std::uint32_t stringCount() const { return strings.size(); }
+
+    // Symbols are not appended: ids are shared by every use of a name, so
+    // the caller re-interns other's names instead.
+    void append(const LiteralTable &other) {
+        numbers.insert(numbers.end(), other.numbers.begin(),
+                       other.numbers.end());
+        integers.insert(integers.end(), other.integers.begin(),
+                        other.integers.end());
+        strings.insert(strings.end(), other.strings.begin(),
+                       other.strings.end());
+    }
+
+  private:
+    std::vector<double> numbers;
+    std::vector<std::int64_t> integers;
+    std::vector<std::string_view> strings;
+    std::deque<std::string> owned; // stable addresses for the views above
+    SymbolInterner interner;
+    SymbolInterner *shared = nullptr;
+};
+
+#endif
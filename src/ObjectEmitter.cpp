@@ -0,0 +1,95 @@
+#include "ObjectEmitter.hpp"
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <iostream>
+#include <mutex>
+
+void ObjectEmitter::initializeTargets() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+#ifdef TOYLANG_ALL_TARGETS
+        llvm::InitializeAllTargetInfos();
+        llvm::InitializeAllTargets();
+        llvm::InitializeAllTargetMCs();
+        llvm::InitializeAllAsmPrinters();
+#else
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+#endif
+    });
+}
+
+ObjectEmitter::ObjectEmitter(const std::string &triple,
+                             const std::string &cpu) {
+    initializeTargets();
+
+    std::string targetTriple =
+        triple.empty() ? llvm::sys::getDefaultTargetTriple() : triple;
+
+    std::string error;
+    const llvm::Target *target =
+        llvm::TargetRegistry::lookupTarget(targetTriple, error);
+    if (target == nullptr) {
+        std::cerr << "Unsupported target '" << targetTriple << "': " << error
+                  << std::endl;
+        return;
+    }
+
+    std::string cpuName = cpu.empty() ? "generic" : cpu;
+    llvm::SubtargetFeatures features;
+    if (cpu == "native") {
+        cpuName = llvm::sys::getHostCPUName().str();
+        llvm::StringMap<bool> hostFeatures;
+        if (llvm::sys::getHostCPUFeatures(hostFeatures))
+            for (auto &feature : hostFeatures)
+                features.AddFeature(feature.first(), feature.second);
+    }
+
+    machine.reset(target->createTargetMachine(
+        targetTriple, cpuName, features.getString(), llvm::TargetOptions(),
+        llvm::Reloc::PIC_));
+}
+
+void ObjectEmitter::prepare(llvm::Module &module) const {
+    module.setTargetTriple(machine->getTargetTriple().str());
+    module.setDataLayout(machine->createDataLayout());
+}
+
+bool ObjectEmitter::emit(llvm::Module &module, const std::string &path) {
+    std::error_code ec;
+    llvm::raw_fd_ostream out(path, ec, llvm::sys::fs::OF_None);
+    if (ec) {
+        std::cerr << "Could not open output file: " << path << ": "
+                  << ec.message() << std::endl;
+        return false;
+    }
+    if (!emit(module, out))
+        return false;
+    out.flush();
+    return !out.has_error();
+}
+
+bool ObjectEmitter::emit(llvm::Module &module,
+                         llvm::SmallVectorImpl<char> &object) {
+    llvm::raw_svector_ostream out(object);
+    return emit(module, out);
+}
+
+bool ObjectEmitter::emit(llvm::Module &module, llvm::raw_pwrite_stream &out) {
+    llvm::legacy::PassManager passes;
+    if (machine->addPassesToEmitFile(passes, out, nullptr,
+                                     llvm::CGFT_ObjectFile)) {
+        std::cerr << "Target cannot emit object files" << std::endl;
+        return false;
+    }
+    passes.run(module);
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef TOYLANG_OBJECTEMITTER_HPP
+#define TOYLANG_OBJECTEMITTER_HPP
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <memory>
+#include <string>
+
+// Lowers a module to a native object file through an llvm::TargetMachine.
+// Only the host's target is linked in unless ToyLang is built with
+// TOYLANG_ALL_TARGETS, so by default a triple override can change the OS
+// or ABI but not the architecture.
+class ObjectEmitter {
+  public:
+    // An empty triple means the host's. A cpu of "native" selects the host
+    // CPU together with every feature it reports; an empty one is generic.
+    ObjectEmitter(const std::string &triple, const std::string &cpu);
+
+    // Registers the targets ToyLang is built with, once per process. LLVM's
+    // target registry has no locking of its own, so every thread that may
+    // need a target calls this rather than LLVM's Initialize functions.
+    static void initializeTargets();
+
+    // False, with the reason on stderr, if the target is unavailable.
+    bool valid() const { return machine != nullptr; }
+
+    llvm::TargetMachine &targetMachine() { return *machine; }
+
+    // Sets module's triple and data layout; call before optimizing it.
+    void prepare(llvm::Module &module) const;
+
+    bool emit(llvm::Module &module, const std::string &path);
+    bool emit(llvm::Module &module, llvm::SmallVectorImpl<char> &object);
+
+  private:
+    std::unique_ptr<llvm::TargetMachine> machine;
+
+    bool emit(llvm::Module &module, llvm::raw_pwrite_stream &out);
+};
+
+#endif
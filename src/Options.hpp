@@ -0,0 +1,63 @@
+#ifndef TOYLANG_OPTIONS_HPP
+#define TOYLANG_OPTIONS_HPP
+
+#include "Diagnostics.hpp"
+
+#include <cstdint>
+#include <string>
+
+struct Options {
+    // Worker threads for compiling many files, or lexing one large file;
+    // 0 means one per hardware thread.
+    unsigned jobs = 0;
+    // Print the parsed tree before compiling it.
+    bool dumpAst = false;
+    // Walk the structure-of-arrays encoding instead of the tree.
+    bool flatAst = false;
+    // Balance long + and * chains; may change floating-point rounding.
+    bool rebalance = false;
+    // Compile to bytecode and interpret it instead of going through LLVM.
+    bool vm = false;
+    // Print each statement's bytecode under vm.
+    bool dumpBytecode = false;
+    // Print the generated module instead of running it.
+    bool emitLlvm = false;
+    // LLVM optimization level, 0 to 3.
+    unsigned optLevel = 0;
+    // Let floating-point code be reassociated and vectorized.
+    bool fastMath = false;
+    // Write native object files instead of running the scripts.
+    bool compileOnly = false;
+    // Link the modules of all scripts into one before running or emitting
+    // it (to output with compileOnly).
+    bool link = false;
+    std::string output;
+    // Target triple (empty for the host) and CPU ("native" for the host's)
+    // for object files.
+    std::string triple;
+    std::string cpu;
+    // Report compile and run time on stderr.
+    bool time = false;
+    // Evaluate constant subexpressions before codegen.
+    bool fold = true;
+    // Share structurally identical subtrees and compile each once.
+    bool hashCons = false;
+    // Reuse optimized modules of unchanged scripts from this directory;
+    // empty disables the cache.
+    std::string cacheDir;
+    // Bytes the cache may hold before least recently used entries go.
+    std::uint64_t cacheSize = std::uint64_t(256) << 20;
+    // Report cache hits and misses on stderr.
+    bool cacheStats = false;
+    // Count how often each statement runs and merge the counts into this
+    // profile file.
+    std::string profileGenerate;
+    // Optimize with the counts recorded in this profile file.
+    std::string profileUse;
+    // Print the most executed statements of the profile.
+    bool profileReport = false;
+    // How the errors of a run are printed.
+    DiagnosticFormat diagnostics = DiagnosticFormat::Human;
+};
+
+#endif
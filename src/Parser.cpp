@@ -0,0 +1,253 @@
+#include "Parser.hpp"
+
+#include <array>
+
+// program   -> statement* EOF
+// statement -> ( "var" IDENTIFIER ( "=" expression )? | expression ) ";"
+//            | "{" statement* "}"
+// The last ";" before a "}" or the end may be left out. A block only
+// scopes the declarations in it, so its statements join the result in
+// order. A statement with an error is reported, skipped up to the next
+// statement boundary and left out of the result, so a single pass finds
+// every syntax error.
+std::vector<const Expr *> Parser::parse() {
+    std::vector<const Expr *> statements;
+
+    while (!isAtEnd()) {
+        if (match(TokenType::LEFT_BRACE)) {
+            scopes.enterScope();
+            continue;
+        }
+        if (scopes.depth() > 0 && match(TokenType::RIGHT_BRACE)) {
+            scopes.exitScope();
+            continue;
+        }
+
+        const Expr *expr =
+            match(TokenType::VAR) ? declaration() : expression();
+        if (expr == nullptr) {
+            synchronize();
+            continue;
+        }
+
+        if (!match(TokenType::SEMICOLON) && !isAtEnd() &&
+            !(scopes.depth() > 0 && check(TokenType::RIGHT_BRACE))) {
+            error(peek(), expr->kind == ExprKind::Declaration
+                              ? "Expect ';' after variable declaration."
+                              : "Expect ';' after expression.");
+            synchronize();
+            continue;
+        }
+
+        statements.push_back(expr);
+    }
+
+    if (scopes.depth() > 0)
+        error(peek(), "Expect '}' after block.");
+    while (scopes.depth() > 0)
+        scopes.exitScope();
+    return statements;
+}
+
+// The name is declared even if its initializer has an error, so that its
+// uses are not reported as well. The initializer is parsed first: inside
+// it the name still means whatever it did before.
+const Expr *Parser::declaration() {
+    if (!check(TokenType::IDENTIFIER)) {
+        error(peek(), "Expect variable name.");
+        return nullptr;
+    }
+    Token name = advance();
+
+    const Expr *initializer = nullptr;
+    if (match(TokenType::EQUAL))
+        initializer = expression();
+    else
+        initializer = builder.literal(
+            Token(TokenType::NIL, name.pos + name.len, 0));
+
+    std::uint32_t slot = scopes.declare(name.literal);
+    if (initializer == nullptr)
+        return nullptr;
+    return builder.declaration(name, slot, initializer);
+}
+
+namespace {
+
+constexpr std::array<Precedence, std::size(tokenTypeNames)> infixTable = [] {
+    std::array<Precedence, std::size(tokenTypeNames)> table{};
+    auto set = [&](TokenType type, Precedence precedence) {
+        table[static_cast<std::size_t>(type)] = precedence;
+    };
+    set(TokenType::OR, Precedence::Or);
+    set(TokenType::AND, Precedence::And);
+    set(TokenType::BANG_EQUAL, Precedence::Equality);
+    set(TokenType::EQUAL_EQUAL, Precedence::Equality);
+    set(TokenType::GREATER, Precedence::Comparison);
+    set(TokenType::GREATER_EQUAL, Precedence::Comparison);
+    set(TokenType::LESS, Precedence::Comparison);
+    set(TokenType::LESS_EQUAL, Precedence::Comparison);
+    set(TokenType::MINUS, Precedence::Term);
+    set(TokenType::PLUS, Precedence::Term);
+    set(TokenType::SLASH, Precedence::Factor);
+    set(TokenType::STAR, Precedence::Factor);
+    return table;
+}();
+
+Precedence next(Precedence precedence) {
+    return static_cast<Precedence>(static_cast<std::uint8_t>(precedence) + 1);
+}
+
+} // namespace
+
+Precedence Parser::infixPrecedence(TokenType type) {
+    return infixTable[static_cast<std::size_t>(type)];
+}
+
+// Every binary operator is left-associative: the right operand binds only
+// operators strictly tighter than the one just consumed. Instead of
+// recursing for each operand, a pending prefix operator, parenthesis or
+// left operand is pushed on frames and completed once its operand is, so
+// nesting depth costs heap rather than native stack. Returns nullptr after
+// reporting an error.
+const Expr *Parser::expression() {
+    frames.clear();
+    Precedence minimum = Precedence::Or;
+
+    while (true) {
+        const Expr *expr = nullptr;
+        while (expr == nullptr) {
+            switch (peek().type) {
+            case TokenType::BANG:
+            case TokenType::MINUS:
+                frames.push_back({Frame::Unary, minimum, nullptr, advance()});
+                minimum = Precedence::Unary;
+                break;
+            case TokenType::LEFT_PAREN:
+                frames.push_back({Frame::Grouping, minimum, nullptr, advance()});
+                minimum = Precedence::Or;
+                break;
+            case TokenType::FALSE:
+            case TokenType::TRUE:
+            case TokenType::NIL:
+            case TokenType::NUMBER:
+            case TokenType::INTEGER:
+            case TokenType::STRING:
+                expr = builder.literal(advance());
+                break;
+            case TokenType::IDENTIFIER: {
+                std::uint32_t slot = scopes.lookup(peek().literal);
+                if (slot == SymbolTable::None) {
+                    error(peek(), "Undefined variable.");
+                    return nullptr;
+                }
+                expr = builder.variable(advance(), slot);
+                break;
+            }
+            default:
+                error(peek(), "Expect expression.");
+                return nullptr;
+            }
+        }
+
+        while (true) {
+            Precedence precedence = infixPrecedence(peek().type);
+            if (precedence != Precedence::None && precedence >= minimum) {
+                frames.push_back({Frame::Binary, minimum, expr, advance()});
+                minimum = next(precedence);
+                break;
+            }
+
+            if (frames.empty())
+                return expr;
+
+            Frame frame = frames.back();
+            frames.pop_back();
+            minimum = frame.minimum;
+
+            switch (frame.kind) {
+            case Frame::Binary:
+                expr = builder.binary(frame.left, frame.op, expr);
+                break;
+            case Frame::Grouping:
+                if (!consume(TokenType::RIGHT_PAREN,
+                             "Expect ')' after expression."))
+                    return nullptr;
+                expr = builder.grouping(expr);
+                break;
+            case Frame::Unary:
+                expr = builder.unary(frame.op, expr);
+                break;
+            }
+        }
+    }
+}
+
+bool Parser::atBlockBoundary() const {
+    return check(TokenType::LEFT_BRACE) ||
+           (scopes.depth() > 0 && check(TokenType::RIGHT_BRACE));
+}
+
+bool Parser::match(TokenType type) {
+    if (!check(type))
+        return false;
+    advance();
+    return true;
+}
+
+bool Parser::check(TokenType type) const {
+    if (isAtEnd())
+        return false;
+    return peek().type == type;
+}
+
+const Token &Parser::advance() {
+    if (!isAtEnd())
+        tokens.advance();
+    return previous();
+}
+
+bool Parser::isAtEnd() const { return peek().type == TokenType::END_OF_FILE; }
+
+const Token &Parser::peek() const { return tokens.peek(); }
+
+const Token &Parser::previous() const { return tokens.previous(); }
+
+bool Parser::consume(TokenType type, const char *message) {
+    if (match(type))
+        return true;
+
+    error(peek(), message);
+    return false;
+}
+
+// Stops at braces too, so that recovery never skips a scope's end.
+void Parser::synchronize() {
+    if (!atBlockBoundary())
+        advance();
+
+    while (!isAtEnd()) {
+        if (atBlockBoundary() || previous().type == TokenType::SEMICOLON)
+            return;
+
+        switch (peek().type) {
+        case TokenType::CLASS:
+        case TokenType::FUN:
+        case TokenType::VAR:
+        case TokenType::FOR:
+        case TokenType::IF:
+        case TokenType::WHILE:
+        case TokenType::PRINT:
+        case TokenType::RETURN:
+            return;
+        default:
+            break;
+        }
+
+        advance();
+    }
+}
+
+void Parser::error(const Token &token, const char *message) {
+    lexer.error(token, message);
+}
@@ -1,46 +1,85 @@
 #ifndef TOYLANG_PARSER_HPP
 #define TOYLANG_PARSER_HPP
 
+#include "Arena.hpp"
 #include "Expr.hpp"
+#include "ExprBuilder.hpp"
+#include "SymbolTable.hpp"
 #include "Token.hpp"
-#include "ToyLang.hpp"
+#include "TokenCursor.hpp"
 
-class ParseError : public std::exception {
-  public:
-    ParseError() {}
+#include <cstdint>
+#include <vector>
+
+// Binding power of infix operators, weakest first.
+enum class Precedence : std::uint8_t {
+    None,
+    Or,         // or
+    And,        // and
+    Equality,   // == !=
+    Comparison, // < > <= >=
+    Term,       // + -
+    Factor,     // * /
+    Unary,      // ! -
 };
 
-template <typename T> class Parser {
+// Pratt parser: a single precedence-climbing loop driven by a constexpr
+// table of infix binding powers replaces one function per precedence level.
+// Tokens are read by reference from the TokenCursor, so the only allocations
+// while parsing are the Arena's node blocks and the frame stack. Names are
+// resolved as they are parsed: each use of a variable becomes a VariableExpr
+// holding its declaration's slot, so no later pass looks a name up.
+class Parser {
   public:
-    Parser(std::vector<Token> tokens) : tokens(tokens) {}
+    // Nodes are allocated from arena and live as long as it does. With
+    // hashCons, identical subtrees are shared (see ExprBuilder). Names are
+    // resolved in scopes, if given, so that its top-level bindings carry
+    // over to the next source parsed with it; the Lexer must then intern
+    // into the same SymbolInterner for all of them.
+    Parser(Lexer &lexer, Arena &arena, bool hashCons = false,
+           SymbolTable *scopes = nullptr)
+        : lexer(lexer), tokens(lexer), builder(lexer, arena, hashCons),
+          scopes(scopes != nullptr ? *scopes : ownScopes) {}
+
+    // The statements that parsed cleanly; errors go to the Lexer's
+    // diagnostics.
+    std::vector<const Expr *> parse();
+
+    static Precedence infixPrecedence(TokenType type);
 
-    std::unique_ptr<Expr<T>> parse();
+    const ExprBuilder &nodes() const { return builder; }
 
   private:
-    std::vector<Token> tokens;
-    int current = 0;
-
-    std::unique_ptr<Expr<T>> expression() noexcept(false);
-    std::unique_ptr<Expr<T>> equality() noexcept(false);
-    std::unique_ptr<Expr<T>> comparison() noexcept(false);
-    std::unique_ptr<Expr<T>> addition() noexcept(false);
-    std::unique_ptr<Expr<T>> multiplication() noexcept(false);
-    std::unique_ptr<Expr<T>> unary() noexcept(false);
-    std::unique_ptr<Expr<T>> primary() noexcept(false);
-
-    bool match(std::vector<TokenType> types);
-    bool check(TokenType type);
-    Token advance();
-    bool isAtEnd();
-    Token peek();
-    Token previous();
-    Token consume(TokenType type, std::string message);
+    Lexer &lexer;
+    TokenCursor tokens;
+    ExprBuilder builder;
+    SymbolTable ownScopes;
+    SymbolTable &scopes;
+
+    // An operator or parenthesis still waiting for its operand.
+    struct Frame {
+        enum Kind : std::uint8_t { Binary, Grouping, Unary } kind;
+        Precedence minimum; // restored once the frame completes
+        const Expr *left;
+        Token op;
+    };
+    std::vector<Frame> frames;
+
+    const Expr *declaration();
+    const Expr *expression();
+
+    bool match(TokenType type);
+    bool check(TokenType type) const;
+    const Token &advance();
+    bool isAtEnd() const;
+    const Token &peek() const;
+    const Token &previous() const;
+    bool consume(TokenType type, const char *message);
 
     void synchronize();
+    bool atBlockBoundary() const;
 
-    static ParseError error(Token token, std::string message);
+    void error(const Token &token, const char *message);
 };
 
-#include "Parser.tpp"
-
 #endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "Profile.hpp"
+
+#include <llvm/Support/xxhash.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+std::uint64_t Profile::hash(std::string_view source) {
+    return llvm::xxHash64(llvm::StringRef(source.data(), source.size()));
+}
+
+bool Profile::read(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Could not open profile: " << path << std::endl;
+        return false;
+    }
+
+    std::string line, file;
+    std::uint64_t hash = 0;
+    for (int number = 1; std::getline(in, line); number++) {
+        std::istringstream fields(line);
+        if (line.starts_with("file ")) {
+            std::string keyword;
+            fields >> keyword >> std::hex >> hash >> std::ws;
+            std::getline(fields, file);
+            if (!fields.fail() && !file.empty())
+                continue;
+        } else {
+            Counter counter;
+            fields >> counter.statement >> counter.line >> counter.pos >>
+                counter.count;
+            if (fields && !file.empty()) {
+                add(file, hash, counter);
+                continue;
+            }
+        }
+        std::cerr << path << ":" << number << ": malformed profile line"
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Profile::write(const std::string &path) const {
+    Profile merged;
+    if (std::filesystem::exists(path) && !merged.read(path))
+        return false;
+    for (const auto &[file, script] : scripts)
+        for (const auto &[statement, counter] : script.counters)
+            merged.add(file, script.hash, counter);
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary);
+        for (const auto &[file, script] : merged.scripts) {
+            char hash[17];
+            std::snprintf(hash, sizeof(hash), "%016llx",
+                          static_cast<unsigned long long>(script.hash));
+            out << "file " << hash << ' ' << file << '\n';
+            for (const auto &[statement, c] : script.counters)
+                out << c.statement << ' ' << c.line << ' ' << c.pos << ' '
+                    << c.count << '\n';
+        }
+        if (!out.flush()) {
+            std::cerr << "Could not write profile: " << path << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::cerr << "Could not write profile: " << path << ": "
+                  << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Profile::add(const std::string &file, std::uint64_t hash,
+                  Counter counter) {
+    Script &script = scripts[file];
+    if (script.hash != hash) {
+        script.hash = hash;
+        script.counters.clear();
+    }
+
+    auto [existing, added] =
+        script.counters.try_emplace(counter.statement, counter);
+    if (added)
+        return;
+    // A statement that moved is a different statement.
+    if (existing->second.line == counter.line &&
+        existing->second.pos == counter.pos)
+        existing->second.count += counter.count;
+    else
+        existing->second = counter;
+}
+
+const Profile::Counters *
+Profile::counters(const std::string &file, std::uint64_t hash) const {
+    auto script = scripts.find(file);
+    if (script == scripts.end() || script->second.hash != hash)
+        return nullptr;
+    return &script->second.counters;
+}
+
+std::vector<Profile::HotSpot> Profile::hottest(std::size_t n) const {
+    std::vector<HotSpot> spots;
+    for (const auto &[file, script] : scripts)
+        for (const auto &[statement, counter] : script.counters)
+            spots.push_back({&file, counter});
+
+    std::stable_sort(spots.begin(), spots.end(),
+                     [](const HotSpot &a, const HotSpot &b) {
+                         return a.counter.count > b.counter.count;
+                     });
+    if (spots.size() > n)
+        spots.resize(n);
+    return spots;
+}
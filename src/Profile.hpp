@@ -0,0 +1,57 @@
+#ifndef TOYLANG_PROFILE_HPP
+#define TOYLANG_PROFILE_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Execution counts of compiled statements, per script. A script's counts
+// are tied to a hash of its source and ignored once it changes. The file is
+// text, one "file <hash> <path>" line per script followed by a
+// "<statement> <line> <pos> <count>" line per statement, so it can be read
+// and edited by hand; writing merges into what is already there, so
+// profiles of many runs add up.
+class Profile {
+  public:
+    struct Counter {
+        std::uint32_t statement;
+        std::uint32_t line;
+        std::uint32_t pos;
+        std::uint64_t count;
+    };
+
+    static std::uint64_t hash(std::string_view source);
+
+    // False, with the reason on stderr, if path cannot be read or parsed.
+    bool read(const std::string &path);
+    // Merges into path, replacing it atomically.
+    bool write(const std::string &path) const;
+
+    // Adds to the counter of the same statement; a different hash replaces
+    // the file's counters.
+    void add(const std::string &file, std::uint64_t hash, Counter counter);
+
+    // The counters of file by statement, if they were recorded for this
+    // hash.
+    using Counters = std::map<std::uint32_t, Counter>;
+    const Counters *counters(const std::string &file,
+                             std::uint64_t hash) const;
+
+    struct HotSpot {
+        const std::string *file;
+        Counter counter;
+    };
+    // The n most executed statements, hottest first.
+    std::vector<HotSpot> hottest(std::size_t n) const;
+
+  private:
+    struct Script {
+        std::uint64_t hash;
+        Counters counters;
+    };
+    std::map<std::string, Script> scripts;
+};
+
+#endif
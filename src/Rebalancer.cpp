@@ -0,0 +1,189 @@
+#include "Rebalancer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+bool isAssociative(TokenType type) {
+    return type == TokenType::PLUS || type == TokenType::STAR;
+}
+
+} // namespace
+
+const Expr *Rebalancer::rebalance(const Expr *root) {
+    work.clear();
+    results.clear();
+    ops.clear();
+    memo.clear();
+
+    expand(root);
+    while (!work.empty()) {
+        Task task = work.back();
+        work.pop_back();
+        if (task.operands == Memoize) {
+            const Result &result = results.back();
+            // A node that replaces a shared one is new, made from arena by
+            // this pass, and takes over its sharing.
+            if (result.expr != task.expr)
+                const_cast<Expr *>(result.expr)->shared = true;
+            memo.emplace(task.expr, result);
+        } else if (task.operands == 0) {
+            expand(task.expr);
+        } else {
+            results.push_back(combine(task.expr, task.operands));
+        }
+    }
+
+    return results.back().expr;
+}
+
+// Schedules expr's operands ahead of expr itself. For the root of an
+// associative chain the operands are every term of the chain, found by
+// walking down its left spine; their operators wait on ops, in order.
+void Rebalancer::expand(const Expr *expr) {
+    if (expr->shared) {
+        if (auto it = memo.find(expr); it != memo.end()) {
+            results.push_back(it->second);
+            return;
+        }
+        work.push_back({expr, Memoize});
+    }
+
+    switch (expr->kind) {
+    case ExprKind::Binary: {
+        auto &binary = static_cast<const BinaryExpr &>(*expr);
+        std::size_t first = work.size() + 1;
+        std::size_t firstOp = ops.size();
+        work.push_back({expr, 0});
+
+        const Expr *spine = expr;
+        while (spine->kind == ExprKind::Binary &&
+               static_cast<const BinaryExpr *>(spine)->op.type ==
+                   binary.op.type) {
+            auto *link = static_cast<const BinaryExpr *>(spine);
+            work.push_back({link->right, 0});
+            ops.push_back(link->op);
+            spine = link->left;
+            if (!isAssociative(binary.op.type))
+                break;
+        }
+        work.push_back({spine, 0});
+
+        work[first - 1].operands = work.size() - first;
+        std::reverse(ops.begin() + firstOp, ops.end());
+        break;
+    }
+    case ExprKind::Declaration:
+        work.push_back({expr, 1});
+        work.push_back(
+            {static_cast<const DeclarationExpr &>(*expr).initializer, 0});
+        break;
+    case ExprKind::Grouping:
+        work.push_back({expr, 1});
+        work.push_back(
+            {static_cast<const GroupingExpr &>(*expr).expression, 0});
+        break;
+    case ExprKind::Literal: {
+        auto &literal = static_cast<const LiteralExpr &>(*expr);
+        results.push_back({expr, literal.value.type == TokenType::STRING});
+        break;
+    }
+    case ExprKind::Unary:
+        work.push_back({expr, 1});
+        work.push_back({static_cast<const UnaryExpr &>(*expr).right, 0});
+        break;
+    case ExprKind::Variable:
+        // Its type is not known before TypeChecker runs.
+        results.push_back({expr, true});
+        break;
+    }
+}
+
+Rebalancer::Result Rebalancer::combine(const Expr *expr,
+                                       std::uint32_t operands) {
+    switch (expr->kind) {
+    case ExprKind::Binary:
+        return chain(static_cast<const BinaryExpr &>(*expr), operands);
+    case ExprKind::Declaration: {
+        Result initializer = results.back();
+        results.pop_back();
+        auto &declaration = static_cast<const DeclarationExpr &>(*expr);
+        if (initializer.expr == declaration.initializer)
+            return {expr, false};
+        return {arena.make<DeclarationExpr>(declaration.name, declaration.slot,
+                                            initializer.expr),
+                false};
+    }
+    case ExprKind::Grouping: {
+        Result inner = results.back();
+        results.pop_back();
+        auto &grouping = static_cast<const GroupingExpr &>(*expr);
+        if (inner.expr == grouping.expression)
+            return {expr, inner.mayBeString};
+        return {arena.make<GroupingExpr>(inner.expr), inner.mayBeString};
+    }
+    case ExprKind::Unary: {
+        Result right = results.back();
+        results.pop_back();
+        auto &unary = static_cast<const UnaryExpr &>(*expr);
+        if (right.expr == unary.right)
+            return {expr, false};
+        return {arena.make<UnaryExpr>(unary.op, right.expr), false};
+    }
+    case ExprKind::Literal:
+    case ExprKind::Variable:
+        break;
+    }
+    return results.back();
+}
+
+// Pairs up neighbouring terms level by level. The operator joining two
+// groups is the one that followed the left group's last term in the
+// source, so diagnostics still point into the chain.
+Rebalancer::Result Rebalancer::chain(const BinaryExpr &root,
+                                     std::uint32_t operands) {
+    auto terms = results.end() - operands;
+    const Token *op = ops.data() + ops.size() - (operands - 1);
+
+    bool mayBeString = root.op.type == TokenType::PLUS &&
+                       std::any_of(terms, results.end(), [](const Result &r) {
+                           return r.mayBeString;
+                       });
+    // Comparisons, -, * and / never produce strings.
+    Result result = {nullptr, mayBeString};
+
+    bool unchanged = operands == 2 && terms[0].expr == root.left &&
+                     terms[1].expr == root.right;
+    if (unchanged) {
+        result.expr = &root;
+    } else if (operands == 2 || mayBeString) {
+        const Expr *left = terms[0].expr;
+        for (std::uint32_t i = 1; i < operands; i++)
+            left = arena.make<BinaryExpr>(left, op[i - 1], terms[i].expr);
+        result.expr = left;
+    } else {
+        // (group, index of its last term) pairs, reduced in place.
+        std::vector<std::pair<const Expr *, std::uint32_t>> level;
+        level.reserve(operands);
+        for (std::uint32_t i = 0; i < operands; i++)
+            level.push_back({terms[i].expr, i});
+
+        while (level.size() > 1) {
+            std::size_t out = 0;
+            for (std::size_t i = 0; i + 1 < level.size(); i += 2)
+                level[out++] = {arena.make<BinaryExpr>(
+                                    level[i].first, op[level[i].second],
+                                    level[i + 1].first),
+                                level[i + 1].second};
+            if (level.size() % 2 == 1)
+                level[out++] = level.back();
+            level.resize(out);
+        }
+        result.expr = level.front().first;
+    }
+
+    results.erase(terms, results.end());
+    ops.resize(ops.size() - (operands - 1));
+    return result;
+}
@@ -0,0 +1,56 @@
+#ifndef TOYLANG_REBALANCER_HPP
+#define TOYLANG_REBALANCER_HPP
+
+#include "Arena.hpp"
+#include "Expr.hpp"
+#include "Token.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Rewrites long chains of one associative operator (+ or *) from the
+// parser's left-deep shape into balanced trees, so the depth of a chain of n
+// terms drops from n to log2(n) and its operations no longer form a single
+// serial dependency. This reassociates floating-point arithmetic and may
+// change the rounding of the result (or, in a chain mixing integers and
+// doubles, where integers are promoted), so it only runs when asked for. Chains
+// of + that may involve a string (which includes any with a variable) are
+// left alone, since concatenation mixed with addition depends on evaluation
+// order. A shared (hash-consed) subtree is rebalanced once and its result
+// shared in turn, except for one that is a link of a longer chain: the
+// chain is regrouped around it, so it no longer exists to be shared.
+class Rebalancer {
+  public:
+    // New nodes are allocated from arena; unchanged subtrees are shared.
+    explicit Rebalancer(Arena &arena) : arena(arena) {}
+
+    const Expr *rebalance(const Expr *root);
+
+  private:
+    struct Result {
+        const Expr *expr;
+        bool mayBeString;
+    };
+
+    struct Task {
+        const Expr *expr;
+        // Operands of the node already on the result stack, 0 when its
+        // children have not been scheduled yet, or Memoize to record the
+        // result of a shared node.
+        std::uint32_t operands;
+    };
+    static constexpr std::uint32_t Memoize = UINT32_MAX;
+
+    Arena &arena;
+    std::vector<Task> work;
+    std::vector<Result> results;
+    std::vector<Token> ops;
+    std::unordered_map<const Expr *, Result> memo;
+
+    void expand(const Expr *expr);
+    Result combine(const Expr *expr, std::uint32_t operands);
+    Result chain(const BinaryExpr &root, std::uint32_t operands);
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "Repl.hpp"
+#include "Runtime.hpp"
+
+#include <llvm/Support/Format.h>
+
+#include <algorithm>
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+Repl::Repl(const Options &options, llvm::raw_ostream &out,
+           std::ostream &errors)
+    : options(options), out(out), errors(errors) {}
+
+bool Repl::eval(std::string_view line) {
+    // Entry names stay unique, so a line's code never clashes with one
+    // that is still being removed.
+    Session session(line, options,
+                    "toy_line" + std::to_string(evaluated++), &globals);
+    if (!session.compile())
+        return false;
+    out << session.listing();
+
+    bool stringVariables =
+        std::find(globals.types.begin(), globals.types.end(),
+                  ValueType::String) != globals.types.end();
+
+    auto jitStart = Clock::now();
+    auto runStart = jitStart, runEnd = jitStart;
+
+    if (options.vm) {
+        std::vector<Session::Result> results;
+        runStart = Clock::now();
+        for (const Chunk &chunk : session.bytecode())
+            results.push_back(vm.run(chunk));
+        runEnd = Clock::now();
+
+        for (std::size_t i = 0; i < results.size(); i++)
+            if (session.bytecode()[i].type != ValueType::Unknown)
+                out << Session::format(session.bytecode()[i].type, results[i])
+                    << '\n';
+        if (!stringVariables)
+            vm.release();
+    } else if (!options.emitLlvm && !session.entries().empty()) {
+        // The JIT is only started by the first line that needs it.
+        if (jit == nullptr)
+            jit = std::make_unique<JIT>();
+        auto tracker = jit->addTracked(session.compiler().takeModule());
+
+        std::vector<void *> functions;
+        for (const Session::Entry &entry : session.entries())
+            functions.push_back(jit->lookup<void>(entry.name));
+
+        std::vector<Session::Result> results;
+        runStart = Clock::now();
+        for (std::size_t i = 0; i < functions.size(); i++)
+            results.push_back(
+                Session::call(session.entries()[i], functions[i]));
+        runEnd = Clock::now();
+
+        // Strings point into the line's code or the string runtime, so
+        // print before freeing both.
+        for (std::size_t i = 0; i < results.size(); i++)
+            if (session.entries()[i].type != ValueType::Unknown)
+                out << Session::format(session.entries()[i].type, results[i])
+                    << '\n';
+        // Declarations are the entries of type Unknown.
+        if (std::none_of(session.entries().begin(), session.entries().end(),
+                         [](const Session::Entry &entry) {
+                             return entry.type == ValueType::Unknown;
+                         }))
+            jit->remove(tracker);
+        if (!stringVariables)
+            toy_string_release();
+    }
+    out.flush();
+
+    if (options.time && options.vm) {
+        llvm::errs() << llvm::format("bytecode %.3f ms, run %.3f ms\n",
+                                     session.codegenSeconds() * 1000,
+                                     Milliseconds(runEnd - runStart).count());
+    } else if (options.time) {
+        llvm::errs() << llvm::format(
+            "codegen %.3f ms, -O%u %.3f ms, jit %.3f ms, run %.3f ms\n",
+            session.codegenSeconds() * 1000, options.optLevel,
+            session.optimizeSeconds() * 1000,
+            Milliseconds(runStart - jitStart).count(),
+            Milliseconds(runEnd - runStart).count());
+    }
+
+    bool hadError = session.hadError();
+    session.diagnostics().flush(errors, options.diagnostics);
+    return !hadError;
+}
@@ -0,0 +1,46 @@
+#ifndef TOYLANG_REPL_HPP
+#define TOYLANG_REPL_HPP
+
+#include "JIT.hpp"
+#include "Options.hpp"
+#include "Session.hpp"
+#include "VM.hpp"
+
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string_view>
+
+// The interactive prompt's state. One JIT (or, with --vm, one VM) lives as
+// long as the Repl, and every line is compiled by a Session of its own into
+// a module the JIT tracks separately. Once a line's results are printed its
+// tokens, tree, LLVMContext and machine code are all released, so nothing
+// grows with the number of lines and neither does the time a line takes.
+// Only variables outlive their line: the Repl keeps the names, bindings and
+// types of the top level, and the code of a line that declares any stays
+// loaded, since later lines use the globals it defines. Runtime strings
+// are no longer freed once a string variable may point at one.
+class Repl {
+  public:
+    Repl(const Options &options, llvm::raw_ostream &out,
+         std::ostream &errors);
+
+    // Compiles and runs line, printing its results to out and its errors
+    // to errors; false if it had any errors.
+    bool eval(std::string_view line);
+
+    std::size_t lines() const { return evaluated; }
+
+  private:
+    const Options &options;
+    llvm::raw_ostream &out;
+    std::ostream &errors;
+    std::unique_ptr<JIT> jit;
+    VM vm;
+    Session::Globals globals;
+    std::size_t evaluated = 0;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "Runtime.hpp"
+#include "Arena.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class StringHeap {
+  public:
+    ToyString *make(std::string_view left, std::string_view right = {}) {
+        auto *string = arena.make<ToyString>();
+        string->length = left.size() + right.size();
+        char *out = string->small;
+        if (string->length > ToyString::SmallCapacity) {
+            out = static_cast<char *>(arena.allocate(string->length + 1, 1));
+            string->flat = out;
+            string->shape = ToyString::Kind::Flat;
+        }
+        std::memcpy(out, left.data(), left.size());
+        std::memcpy(out + left.size(), right.data(), right.size());
+        out[string->length] = '\0';
+        return string;
+    }
+
+    ToyString *intern(std::string_view text) {
+        if (auto it = interned.find(text); it != interned.end())
+            return it->second;
+        // Keyed by the heap's copy, which outlives the caller's.
+        ToyString *string = make(text);
+        interned.emplace(string->view(), string);
+        return string;
+    }
+
+    ToyString *concat(ToyString *left, ToyString *right) {
+        if (left->length == 0)
+            return right;
+        if (right->length == 0)
+            return left;
+        if (left->length + right->length <= ToyString::SmallCapacity)
+            return make(left->view(), right->view());
+
+        auto *string = arena.make<ToyString>();
+        string->length = left->length + right->length;
+        string->rope = {left, right};
+        string->shape = ToyString::Kind::Rope;
+        return string;
+    }
+
+    // Copies the leaves of rope into one buffer, without recursion, and
+    // turns it into a flat string.
+    void flatten(ToyString &rope) {
+        auto *out = static_cast<char *>(arena.allocate(rope.length + 1, 1));
+        char *cursor = out;
+        pending.push_back(&rope);
+        while (!pending.empty()) {
+            ToyString *string = pending.back();
+            pending.pop_back();
+            switch (string->shape) {
+            case ToyString::Kind::Rope:
+                pending.push_back(string->rope.right);
+                pending.push_back(string->rope.left);
+                break;
+            case ToyString::Kind::Flat:
+                std::memcpy(cursor, string->flat, string->length);
+                cursor += string->length;
+                break;
+            case ToyString::Kind::Small:
+                std::memcpy(cursor, string->small, string->length);
+                cursor += string->length;
+                break;
+            }
+        }
+        *cursor = '\0';
+        rope.flat = out;
+        rope.shape = ToyString::Kind::Flat;
+    }
+
+  private:
+    Arena arena;
+    std::unordered_map<std::string_view, ToyString *> interned;
+    std::vector<ToyString *> pending;
+};
+
+static thread_local std::unique_ptr<StringHeap> heap;
+
+static StringHeap &strings() {
+    if (heap == nullptr)
+        heap = std::make_unique<StringHeap>();
+    return *heap;
+}
+
+const char *ToyString::data() {
+    switch (shape) {
+    case Kind::Small:
+        return small;
+    case Kind::Rope:
+        strings().flatten(*this);
+        break;
+    case Kind::Flat:
+        break;
+    }
+    return flat;
+}
+
+extern "C" {
+
+ToyString *toy_string_literal(const char *data, std::uint64_t size) {
+    return strings().intern(std::string_view(data, size));
+}
+
+// Formatted as an ostream formats a double (%g), like constant folding.
+ToyString *toy_string_from_number(double value) {
+    char text[32];
+    int length = std::snprintf(text, sizeof(text), "%g", value);
+    return strings().make(std::string_view(text, length));
+}
+
+ToyString *toy_string_from_integer(std::int64_t value) {
+    char text[24];
+    int length = std::snprintf(text, sizeof(text), "%lld",
+                               static_cast<long long>(value));
+    return strings().make(std::string_view(text, length));
+}
+
+ToyString *toy_string_from_bool(bool value) {
+    return strings().make(value ? "-1" : "0");
+}
+
+ToyString *toy_string_concat(ToyString *left, ToyString *right) {
+    return strings().concat(left, right);
+}
+
+const char *toy_string_data(ToyString *string) { return string->data(); }
+
+void toy_string_release() { heap.reset(); }
+}
@@ -0,0 +1,66 @@
+#ifndef TOYLANG_RUNTIME_HPP
+#define TOYLANG_RUNTIME_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Strings built while a program runs, for the code Compiler generates and
+// for the VM. Constant concatenations are still done at compile time; only
+// those whose result would exceed ConstantStringLimit come here, so a long
+// chain of + no longer copies its whole prefix at every step.
+//
+// A string of up to SmallCapacity bytes is stored inside its node. A
+// longer concatenation makes a rope node that points at both halves, in
+// constant time, and is flattened into one buffer the first time its
+// characters are needed; building a string of n pieces therefore costs
+// O(n) however it is nested. Literals are interned, so every use of the
+// same text shares one node.
+//
+// Nodes live in a heap per thread until toy_string_release() on that
+// thread; they are never freed one by one.
+class ToyString {
+  public:
+    static constexpr std::size_t SmallCapacity = 22;
+
+    enum class Kind : std::uint8_t { Small, Flat, Rope };
+
+    Kind kind() const { return shape; }
+    std::uint64_t size() const { return length; }
+    // NUL-terminated characters; flattens a rope.
+    const char *data();
+    std::string_view view() { return {data(), length}; }
+
+  private:
+    friend class StringHeap;
+
+    std::uint64_t length = 0;
+    union {
+        char small[SmallCapacity + 1];
+        const char *flat;
+        struct {
+            ToyString *left;
+            ToyString *right;
+        } rope;
+    };
+    Kind shape = Kind::Small;
+};
+
+// Constant concatenations up to this many bytes are folded at compile time.
+inline constexpr std::size_t ConstantStringLimit = 4096;
+
+// Entry points of generated code, with C linkage so the JIT and a linker
+// for -c objects find them by name. Strings are passed as opaque pointers.
+extern "C" {
+ToyString *toy_string_literal(const char *data, std::uint64_t size);
+ToyString *toy_string_from_number(double value);
+ToyString *toy_string_from_integer(std::int64_t value);
+// -1 or 0, as a boolean's sign-extended i1 concatenates.
+ToyString *toy_string_from_bool(bool value);
+ToyString *toy_string_concat(ToyString *left, ToyString *right);
+const char *toy_string_data(ToyString *string);
+// Frees every string made on this thread.
+void toy_string_release();
+}
+
+#endif
@@ -0,0 +1,330 @@
+#include "Session.hpp"
+#include "BytecodeCompiler.hpp"
+#include "FlatAST.hpp"
+#include "Parser.hpp"
+#include "Rebalancer.hpp"
+#include "StringifyAST.hpp"
+#include "TypeChecker.hpp"
+
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <chrono>
+#include <optional>
+#include <iostream>
+#include <sstream>
+
+using Clock = std::chrono::steady_clock;
+
+// Below this a single thread lexes faster than chunks can be handed out.
+static constexpr std::size_t ParallelLexThreshold = 4 * Lexer::DefaultChunkSize;
+
+Session::Session(std::string_view source, const Options &options,
+                 std::string entryPrefix, Globals *globals)
+    : source(source), options(options), entryPrefix(std::move(entryPrefix)),
+      globals(globals), lexer(source) {
+    if (globals != nullptr)
+        lexer.literals().shareSymbols(globals->names);
+    if (!options.vm) {
+        codegen = std::make_unique<Compiler>(lexer, options.fastMath);
+        codegen->instrument(!options.profileGenerate.empty());
+        codegen->exportVariables(globals != nullptr);
+    }
+}
+
+// Where a statement starts, which keys its profile counter.
+static const Token &firstToken(const Expr *expr) {
+    while (true) {
+        switch (expr->kind) {
+        case ExprKind::Binary:
+            expr = static_cast<const BinaryExpr *>(expr)->left;
+            break;
+        case ExprKind::Declaration:
+            return static_cast<const DeclarationExpr *>(expr)->name;
+        case ExprKind::Grouping:
+            expr = static_cast<const GroupingExpr *>(expr)->expression;
+            break;
+        case ExprKind::Literal:
+            return static_cast<const LiteralExpr *>(expr)->value;
+        case ExprKind::Unary:
+            return static_cast<const UnaryExpr *>(expr)->op;
+        case ExprKind::Variable:
+            return static_cast<const VariableExpr *>(expr)->name;
+        }
+    }
+}
+
+// The machine the JIT compiles for, detected as LLJIT detects it.
+static std::unique_ptr<llvm::TargetMachine> hostMachine() {
+    ObjectEmitter::initializeTargets();
+    auto builder = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!builder) {
+        std::cerr << "Unsupported host target: "
+                  << llvm::toString(builder.takeError()) << std::endl;
+        return nullptr;
+    }
+    auto machine = builder->createTargetMachine();
+    if (!machine) {
+        std::cerr << "Unsupported host target: "
+                  << llvm::toString(machine.takeError()) << std::endl;
+        return nullptr;
+    }
+    return std::move(*machine);
+}
+
+bool Session::compile(ThreadPool *pool, CompileCache *cache) {
+    bool cacheable = cache != nullptr && globals == nullptr && !options.vm &&
+                     !options.dumpAst && !options.emitLlvm && !options.link &&
+                     options.profileGenerate.empty() &&
+                     options.profileUse.empty();
+
+    // Objects are built for -c and the cache. Without either the JIT
+    // compiles the module, which is still optimized for the host it runs
+    // on, just as a cached object is.
+    if (options.compileOnly || cacheable) {
+        emitter = options.compileOnly
+                      ? std::make_unique<ObjectEmitter>(options.triple,
+                                                        options.cpu)
+                      : std::make_unique<ObjectEmitter>("", "native");
+        if (!emitter->valid())
+            return false;
+        emitter->prepare(codegen->module());
+    } else if (!options.vm) {
+        host = hostMachine();
+        if (host == nullptr)
+            return false;
+        codegen->module().setTargetTriple(host->getTargetTriple().str());
+        codegen->module().setDataLayout(host->createDataLayout());
+    }
+
+    std::string key;
+    if (cacheable) {
+        key = CompileCache::key(source, options, entryPrefix,
+                                emitter->targetMachine());
+        if (load(*cache, key))
+            return true;
+    }
+
+    if (pool != nullptr && source.size() >= ParallelLexThreshold)
+        lexer.prescan(*pool);
+
+    // A declaration that failed to parse was never checked, but its slot
+    // still needs a type for the sources after this one.
+    if (globals != nullptr)
+        globals->types.resize(globals->scopes.slots(), ValueType::Unknown);
+
+    Parser parser(lexer, arena, options.hashCons,
+                  globals != nullptr ? &globals->scopes : nullptr);
+    std::vector<const Expr *> statements = parser.parse();
+
+    llvm::raw_string_ostream out(text);
+    StringifyAST stringifier(lexer);
+
+    TypeChecker checker(lexer, globals != nullptr ? &globals->types : nullptr);
+    BytecodeCompiler bytecode(lexer);
+
+    auto codegenStart = Clock::now();
+
+    std::vector<std::pair<llvm::Function *, std::uint64_t>> profiled;
+
+    for (std::uint32_t statement = 0; statement < statements.size();
+         statement++) {
+        const Expr *expr = statements[statement];
+        const Token &first = firstToken(expr);
+
+        if (options.fold)
+            expr = ConstantFolder(lexer, arena).fold(expr);
+        if (options.rebalance)
+            expr = Rebalancer(arena).rebalance(expr);
+        ExprTypes types;
+        ValueType type = checker.check(expr, types);
+
+        std::optional<FlatAST> flat;
+        if (options.flatAst)
+            flat = FlatAST::flatten(expr, types);
+        if (options.dumpAst)
+            out << (flat ? stringifier.toString(*flat)
+                         : stringifier.toString(expr))
+                << '\n';
+
+        if (type == ValueType::Unknown)
+            continue;
+        if (expr->kind == ExprKind::Declaration)
+            type = ValueType::Unknown;
+
+        if (options.vm) {
+            Chunk chunk =
+                flat ? bytecode.compile(*flat) : bytecode.compile(expr, types);
+            if (options.dumpBytecode)
+                out << chunk.disassemble();
+            chunks.push_back(std::move(chunk));
+            continue;
+        }
+
+        codegen->begin();
+        llvm::Value *value =
+            flat ? codegen->codegen(*flat) : codegen->codegen(expr, types);
+
+        std::string name = entryPrefix + "_" + std::to_string(compiled.size());
+        llvm::Function *function = codegen->finish(name, type, value);
+        compiled.push_back({name, type, statement,
+                            static_cast<std::uint32_t>(lexer.line(first)),
+                            first.pos});
+
+        if (profile != nullptr) {
+            auto counter = profile->find(statement);
+            if (counter != profile->end() &&
+                counter->second.pos == first.pos)
+                profiled.emplace_back(function, counter->second.count);
+        }
+    }
+
+    if (!profiled.empty())
+        codegen->applyProfile(profiled);
+
+    auto optimizeStart = Clock::now();
+    if (options.vm) {
+        codegenTime =
+            std::chrono::duration<double>(optimizeStart - codegenStart).count();
+        return true;
+    }
+
+    codegen->optimize(options.optLevel,
+                      emitter ? &emitter->targetMachine() : host.get());
+    auto optimizeEnd = Clock::now();
+
+    if (options.emitLlvm)
+        codegen->module().print(out, nullptr);
+
+    codegenTime =
+        std::chrono::duration<double>(optimizeStart - codegenStart).count();
+    optimizeTime =
+        std::chrono::duration<double>(optimizeEnd - optimizeStart).count();
+
+    // Entries with errors are not stored: a hit must reproduce the
+    // diagnostics too.
+    if (!key.empty() && !hadError())
+        store(*cache, key);
+    return true;
+}
+
+// An entry is the number of entry functions, a "<type> <name>" line for
+// each, then the object file.
+void Session::store(CompileCache &cache, const std::string &key) {
+    auto start = Clock::now();
+    llvm::SmallVector<char, 0> code;
+    if (!emitter->emit(codegen->module(), code))
+        return;
+    objectTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::string contents = std::to_string(compiled.size()) + '\n';
+    for (const Entry &entry : compiled)
+        contents += std::to_string(static_cast<int>(entry.type)) + ' ' +
+                    entry.name + '\n';
+    contents.append(code.data(), code.size());
+    cache.store(key, contents);
+
+    object = llvm::MemoryBuffer::getMemBufferCopy(
+        llvm::StringRef(code.data(), code.size()), entryPrefix);
+}
+
+bool Session::load(CompileCache &cache, const std::string &key) {
+    auto start = Clock::now();
+    std::unique_ptr<llvm::MemoryBuffer> contents = cache.lookup(key);
+    if (contents == nullptr)
+        return false;
+
+    llvm::StringRef rest = contents->getBuffer(), line;
+    std::tie(line, rest) = rest.split('\n');
+    std::size_t count;
+    bool valid = !line.getAsInteger(10, count);
+    for (std::size_t i = 0; valid && i < count; i++) {
+        std::tie(line, rest) = rest.split('\n');
+        auto [type, name] = line.split(' ');
+        unsigned value = 0;
+        valid = !type.getAsInteger(10, value) &&
+                value <= static_cast<unsigned>(ValueType::Null) &&
+                !name.empty();
+        if (valid)
+            compiled.push_back({name.str(), static_cast<ValueType>(value)});
+    }
+
+    if (!valid || rest.empty()) {
+        cache.invalidate(key);
+        compiled.clear();
+        return false;
+    }
+
+    object = llvm::MemoryBuffer::getMemBufferCopy(rest, entryPrefix);
+    objectTime = std::chrono::duration<double>(Clock::now() - start).count();
+    fromCache = true;
+    return true;
+}
+
+bool Session::emitObject(const std::string &path) {
+    if (object != nullptr) {
+        std::error_code ec;
+        llvm::raw_fd_ostream out(path, ec, llvm::sys::fs::OF_None);
+        if (ec) {
+            std::cerr << "Could not open output file: " << path << ": "
+                      << ec.message() << std::endl;
+            return false;
+        }
+        out << object->getBuffer();
+        out.close();
+        return !out.has_error();
+    }
+
+    if (emitter == nullptr) {
+        emitter = std::make_unique<ObjectEmitter>(options.triple, options.cpu);
+        if (!emitter->valid())
+            return false;
+        emitter->prepare(codegen->module());
+    }
+    return emitter->emit(codegen->module(), path);
+}
+
+Session::Result Session::call(const Entry &entry, void *function) {
+    Result result{};
+    switch (entry.type) {
+    case ValueType::Unknown:
+        reinterpret_cast<void (*)()>(function)();
+        break;
+    case ValueType::Number:
+        result.number = reinterpret_cast<double (*)()>(function)();
+        break;
+    case ValueType::Integer:
+        result.integer = reinterpret_cast<std::int64_t (*)()>(function)();
+        break;
+    case ValueType::Bool:
+        result.boolean = reinterpret_cast<bool (*)()>(function)();
+        break;
+    default:
+        result.string = reinterpret_cast<const char *(*)()>(function)();
+        break;
+    }
+    return result;
+}
+
+std::string Session::format(ValueType type, const Result &result) {
+    std::ostringstream text;
+    switch (type) {
+    case ValueType::Number:
+        text << result.number;
+        break;
+    case ValueType::Integer:
+        text << result.integer;
+        break;
+    case ValueType::Bool:
+        text << (result.boolean ? "true" : "false");
+        break;
+    case ValueType::Null:
+        text << "null";
+        break;
+    default:
+        text << result.string;
+        break;
+    }
+    return text.str();
+}
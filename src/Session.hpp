@@ -0,0 +1,139 @@
+#ifndef TOYLANG_SESSION_HPP
+#define TOYLANG_SESSION_HPP
+
+#include "Arena.hpp"
+#include "Bytecode.hpp"
+#include "CompileCache.hpp"
+#include "Compiler.hpp"
+#include "ConstantFolder.hpp"
+#include "Lexer.hpp"
+#include "ObjectEmitter.hpp"
+#include "Options.hpp"
+#include "Profile.hpp"
+#include "SymbolTable.hpp"
+#include "ThreadPool.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Everything it takes to compile one source: its Lexer (which also holds
+// the diagnostics), Arena and Compiler with a private LLVMContext. Sessions
+// share nothing mutable but their Globals, if any, so many of them can
+// compile on different threads.
+class Session {
+  public:
+    // A compiled statement: a function of no arguments named name. A
+    // declaration's type is Unknown: it returns nothing and is not printed.
+    struct Entry {
+        std::string name;
+        ValueType type;
+        // The statement's index and where it starts, for profiles.
+        std::uint32_t statement = 0;
+        std::uint32_t line = 0;
+        std::uint32_t pos = 0;
+    };
+
+    // What an entry function returned; the member its type names is set.
+    struct Result {
+        double number;
+        std::int64_t integer;
+        bool boolean;
+        const char *string;
+    };
+
+    // Calls function, the compiled code of entry.
+    static Result call(const Entry &entry, void *function);
+    // A result of type as the driver prints it, e.g. "3.5", "true" or "a1".
+    static std::string format(ValueType type, const Result &result);
+
+    // The top level that sources compiled one after another share, as the
+    // prompt's lines do: what names mean and the types of their slots. The
+    // code of one source then reaches the variables of an earlier one
+    // through exported globals (or, with --vm, the VM's slots), which must
+    // still be loaded when it runs.
+    struct Globals {
+        SymbolInterner names{true};
+        SymbolTable scopes;
+        std::vector<ValueType> types;
+    };
+
+    // Entry functions are named <entryPrefix>_<statement index>. With
+    // globals, the source starts from and adds to what they hold.
+    Session(std::string_view source, const Options &options,
+            std::string entryPrefix, Globals *globals = nullptr);
+
+    // Lexes, parses, folds and generates one function per statement, then
+    // optimizes the module. A large source is lexed in parallel on pool, if
+    // given; pool must not be the one running this call.
+    //
+    // With a cache the module is compiled on to a native object (for the
+    // host, or the -c target) that is stored with the list of entries, so
+    // an unchanged source skips the front end and instruction selection
+    // alike. --dump-ast, --emit-llvm and --link need the tree or the module
+    // and bypass the cache.
+    //
+    // With --vm each statement becomes a bytecode Chunk instead, and no
+    // LLVM state is created at all.
+    //
+    // False, with the reason on stderr, if the target is unavailable.
+    bool compile(ThreadPool *pool = nullptr, CompileCache *cache = nullptr);
+
+    // Writes the native object file; false (after reporting why on stderr)
+    // if that is impossible.
+    bool emitObject(const std::string &path);
+
+    // Counters from --profile-use for this source; call before compile().
+    void useProfile(const Profile::Counters *counters) { profile = counters; }
+
+    // The host object compiled for a cache, which the JIT links instead of
+    // the module (empty after a cache hit); nullptr without one.
+    std::unique_ptr<llvm::MemoryBuffer> takeObject() {
+        return std::move(object);
+    }
+
+    std::string_view sourceText() const { return source; }
+    bool hadError() const { return !lexer.diagnostics().empty(); }
+    Diagnostics &diagnostics() { return lexer.diagnostics(); }
+    // The LLVM backend; there is none with --vm.
+    Compiler &compiler() { return *codegen; }
+    const std::vector<Entry> &entries() const { return compiled; }
+    // With --vm, the code of each statement that compiled, in order.
+    const std::vector<Chunk> &bytecode() const { return chunks; }
+    bool cached() const { return fromCache; }
+
+    // Output of --dump-ast and --emit-llvm, held back so that the sessions
+    // of a parallel build can be printed in order.
+    const std::string &listing() const { return text; }
+
+    double codegenSeconds() const { return codegenTime; }
+    double optimizeSeconds() const { return optimizeTime; }
+    double objectSeconds() const { return objectTime; }
+
+  private:
+    const std::string_view source;
+    const Options &options;
+    const std::string entryPrefix;
+    Globals *const globals;
+    Lexer lexer;
+    Arena arena;
+    std::unique_ptr<Compiler> codegen;
+    std::unique_ptr<ObjectEmitter> emitter;
+    // The host's machine, for a JIT module built without an emitter.
+    std::unique_ptr<llvm::TargetMachine> host;
+    std::vector<Entry> compiled;
+    std::vector<Chunk> chunks;
+    std::string text;
+    double codegenTime = 0;
+    double optimizeTime = 0;
+    double objectTime = 0;
+    std::unique_ptr<llvm::MemoryBuffer> object;
+    const Profile::Counters *profile = nullptr;
+    bool fromCache = false;
+
+    void store(CompileCache &cache, const std::string &key);
+    bool load(CompileCache &cache, const std::string &key);
+};
+
+#endif
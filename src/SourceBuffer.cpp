@@ -0,0 +1,96 @@
+#include "SourceBuffer.hpp"
+
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TOYLANG_HAVE_MMAP 1
+#else
+#include <fstream>
+#include <iostream>
+#endif
+
+SourceBuffer::SourceBuffer(std::string text) : owned(std::move(text)) {
+    data = owned.data();
+    size = owned.size();
+}
+
+SourceBuffer::SourceBuffer(const char *data, std::size_t size)
+    : data(data), size(size), mapped(true) {}
+
+SourceBuffer::~SourceBuffer() {
+#ifdef TOYLANG_HAVE_MMAP
+    if (mapped)
+        munmap(const_cast<char *>(data), size);
+#endif
+}
+
+std::unique_ptr<SourceBuffer> SourceBuffer::fromStream(std::istream &stream) {
+    std::ostringstream buffer;
+    buffer << stream.rdbuf();
+    return std::make_unique<SourceBuffer>(std::move(buffer).str());
+}
+
+#ifdef TOYLANG_HAVE_MMAP
+
+static std::unique_ptr<SourceBuffer> readAll(int fd, std::size_t hint) {
+    std::string text;
+    text.reserve(hint);
+
+    char chunk[1 << 16];
+    while (true) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0)
+            return nullptr;
+        if (n == 0)
+            break;
+        text.append(chunk, n);
+    }
+
+    return std::make_unique<SourceBuffer>(std::move(text));
+}
+
+std::unique_ptr<SourceBuffer> SourceBuffer::fromFile(const char *path) {
+    bool isStdin = std::string_view(path) == "-";
+    int fd = isStdin ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info = {};
+    bool regular = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+    if (regular && info.st_size > 0) {
+        void *mapping =
+            mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+            if (!isStdin)
+                close(fd);
+            return std::unique_ptr<SourceBuffer>(new SourceBuffer(
+                static_cast<const char *>(mapping), info.st_size));
+        }
+    }
+
+    // Pipes, terminals and anything mmap refuses: read it once.
+    std::size_t hint = regular ? info.st_size : 0;
+    auto buffer = readAll(fd, hint);
+    if (!isStdin)
+        close(fd);
+    return buffer;
+}
+
+#else
+
+std::unique_ptr<SourceBuffer> SourceBuffer::fromFile(const char *path) {
+    if (std::string_view(path) == "-")
+        return fromStream(std::cin);
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return nullptr;
+    return fromStream(file);
+}
+
+#endif
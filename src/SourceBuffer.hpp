@@ -0,0 +1,38 @@
+#ifndef TOYLANG_SOURCEBUFFER_HPP
+#define TOYLANG_SOURCEBUFFER_HPP
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Read-only view of a script's bytes. Regular files are memory-mapped so the
+// source is never copied; pipes, stdin and the REPL fall back to a single
+// owned buffer. The Lexer borrows the text through view(), so the buffer must
+// outlive every token produced from it.
+class SourceBuffer {
+  public:
+    // Returns nullptr if the file cannot be opened. A path of "-" reads stdin.
+    static std::unique_ptr<SourceBuffer> fromFile(const char *path);
+    static std::unique_ptr<SourceBuffer> fromStream(std::istream &stream);
+
+    explicit SourceBuffer(std::string text);
+    ~SourceBuffer();
+
+    SourceBuffer(const SourceBuffer &) = delete;
+    SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+    std::string_view view() const { return std::string_view(data, size); }
+    bool isMapped() const { return mapped; }
+
+  private:
+    SourceBuffer(const char *data, std::size_t size);
+
+    const char *data = nullptr;
+    std::size_t size = 0;
+    bool mapped = false;
+    std::string owned;
+};
+
+#endif
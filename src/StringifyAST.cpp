@@ -1,40 +1,114 @@
 #include "StringifyAST.hpp"
 
-std::string StringifyAST::toString(std::unique_ptr<Expr<std::string>> &expr) {
+#include <charconv>
+
+std::string StringifyAST::toString(const Expr *expr) {
     return expr->accept(*this);
 }
 
-std::string StringifyAST::visit(BinaryExpr<std::string> &expr) {
-    std::vector<std::unique_ptr<Expr<std::string>>> exprs;
-    exprs.push_back(std::move(expr.left));
-    exprs.push_back(std::move(expr.right));
-    return parenthesize(expr.op.lexeme, exprs);
+std::string StringifyAST::toString(const FlatAST &ast) {
+    std::vector<std::string> parts;
+
+    for (FlatAST::Index node = 0; node < ast.size(); node++) {
+        switch (ast.kind(node)) {
+        case ExprKind::Binary: {
+            std::string right = std::move(parts.back());
+            parts.pop_back();
+            parts.back() = parenthesize(
+                std::string(spelling(ast.token(node).type)),
+                {std::move(parts.back()), std::move(right)});
+            break;
+        }
+        case ExprKind::Declaration: {
+            std::string name(lexer.lexeme(ast.token(node)));
+            parts.back() =
+                parenthesize("var " + name, {std::move(parts.back())});
+            break;
+        }
+        case ExprKind::Grouping:
+            parts.back() = parenthesize("group", {std::move(parts.back())});
+            break;
+        case ExprKind::Literal:
+            parts.push_back(literal(ast.token(node)));
+            break;
+        case ExprKind::Unary:
+            parts.back() =
+                parenthesize(std::string(spelling(ast.token(node).type)),
+                             {std::move(parts.back())});
+            break;
+        case ExprKind::Variable:
+            parts.emplace_back(lexer.lexeme(ast.token(node)));
+            break;
+        }
+    }
+
+    return parts.back();
 }
 
-std::string StringifyAST::visit(GroupingExpr<std::string> &expr) {
-    std::vector<std::unique_ptr<Expr<std::string>>> exprs;
-    exprs.push_back(std::move(expr.expression));
-    return parenthesize("group", exprs);
+std::string StringifyAST::visit(const BinaryExpr &expr, std::string left,
+                                std::string right) {
+    return parenthesize(std::string(spelling(expr.op.type)),
+                        {std::move(left), std::move(right)});
 }
 
-std::string StringifyAST::visit(LiteralExpr<std::string> &expr) {
-    return expr.value.toString();
+std::string StringifyAST::visit(const DeclarationExpr &expr,
+                                std::string initializer) {
+    return parenthesize("var " + std::string(lexer.lexeme(expr.name)),
+                        {std::move(initializer)});
 }
 
-std::string StringifyAST::visit(UnaryExpr<std::string> &expr) {
-    std::vector<std::unique_ptr<Expr<std::string>>> exprs;
-    exprs.push_back(std::move(expr.right));
-    return parenthesize(expr.op.lexeme, exprs);
+std::string StringifyAST::visit(const GroupingExpr &, std::string expression) {
+    return parenthesize("group", {std::move(expression)});
 }
 
-std::string StringifyAST::parenthesize(
-    const std::string &name,
-    std::vector<std::unique_ptr<Expr<std::string>>> &exprs) {
+std::string StringifyAST::visit(const LiteralExpr &expr) {
+    return literal(expr.value);
+}
+
+// Literals print by value rather than by lexeme, since a folded literal's
+// token spans the whole expression it replaced.
+std::string StringifyAST::literal(const Token &token) {
+    std::string result(name(token.type));
+    result += " ";
+
+    switch (token.type) {
+    case TokenType::NUMBER: {
+        char buffer[32];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer),
+                                       lexer.literals().number(token));
+        result.append(buffer, end);
+        break;
+    }
+    case TokenType::INTEGER:
+        result += std::to_string(lexer.literals().integer(token));
+        break;
+    case TokenType::STRING:
+        result += lexer.literals().string(token);
+        break;
+    default:
+        result += spelling(token.type);
+        break;
+    }
+    return result;
+}
+
+std::string StringifyAST::visit(const UnaryExpr &expr, std::string right) {
+    return parenthesize(std::string(spelling(expr.op.type)),
+                        {std::move(right)});
+}
+
+std::string StringifyAST::visit(const VariableExpr &expr) {
+    return std::string(lexer.lexeme(expr.name));
+}
+
+std::string
+StringifyAST::parenthesize(const std::string &name,
+                           std::initializer_list<std::string> parts) {
     std::string result = "(" + name;
-    for (auto &expr : exprs) {
+    for (const std::string &part : parts) {
         result += " ";
-        result += expr->accept(*this);
+        result += part;
     }
     result += ")";
     return result;
-}
\ No newline at end of file
+}
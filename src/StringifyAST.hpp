@@ -2,25 +2,37 @@
 #define TOYLANG_STRINGIFYAST_HPP
 
 #include <iostream>
-#include <memory>
+#include <initializer_list>
 #include <string>
 #include <vector>
 
 #include "Expr.hpp"
+#include "FlatAST.hpp"
+#include "Lexer.hpp"
 
 class StringifyAST : public ExprVisitor<std::string> {
   public:
-    std::string toString(std::unique_ptr<Expr<std::string>> &expr);
+    StringifyAST(const Lexer &lexer) : lexer(lexer) {}
 
-    std::string visit(BinaryExpr<std::string> &expr) override;
-    std::string visit(GroupingExpr<std::string> &expr) override;
-    std::string visit(LiteralExpr<std::string> &expr) override;
-    std::string visit(UnaryExpr<std::string> &expr) override;
+    std::string toString(const Expr *expr);
+    std::string toString(const FlatAST &ast);
+
+    std::string visit(const BinaryExpr &expr, std::string left,
+                      std::string right) override;
+    std::string visit(const DeclarationExpr &expr,
+                      std::string initializer) override;
+    std::string visit(const GroupingExpr &expr,
+                      std::string expression) override;
+    std::string visit(const LiteralExpr &expr) override;
+    std::string visit(const UnaryExpr &expr, std::string right) override;
+    std::string visit(const VariableExpr &expr) override;
 
   private:
-    std::string
-    parenthesize(const std::string &name,
-                 std::vector<std::unique_ptr<Expr<std::string>>> &exprs);
+    const Lexer &lexer;
+
+    std::string literal(const Token &token);
+    std::string parenthesize(const std::string &name,
+                             std::initializer_list<std::string> parts);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "SymbolTable.hpp"
+
+// FNV-1a; identifiers are short.
+static std::uint32_t hash(std::string_view name) {
+    std::uint32_t hash = 2166136261u;
+    for (char c : name)
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    return hash;
+}
+
+Symbol SymbolInterner::intern(std::string_view name) {
+    if (2 * (names.size() + 1) > buckets.size())
+        grow();
+
+    std::uint32_t code = hash(name);
+    std::size_t mask = buckets.size() - 1;
+    for (std::size_t i = code & mask;; i = (i + 1) & mask) {
+        Bucket &bucket = buckets[i];
+        if (bucket.symbol == Empty) {
+            bucket = {code, static_cast<Symbol>(names.size())};
+            names.push_back(copyNames
+                                ? std::string_view(copies.emplace_back(name))
+                                : name);
+            return bucket.symbol;
+        }
+        if (bucket.hash == code && names[bucket.symbol] == name)
+            return bucket.symbol;
+    }
+}
+
+void SymbolInterner::grow() {
+    std::vector<Bucket> old = std::move(buckets);
+    buckets.assign(old.empty() ? 64 : 2 * old.size(), Bucket());
+    std::size_t mask = buckets.size() - 1;
+    for (const Bucket &bucket : old) {
+        if (bucket.symbol == Empty)
+            continue;
+        std::size_t i = bucket.hash & mask;
+        while (buckets[i].symbol != Empty)
+            i = (i + 1) & mask;
+        buckets[i] = bucket;
+    }
+}
+
+void SymbolTable::exitScope() {
+    std::size_t marker = markers.back();
+    markers.pop_back();
+    while (shadowed.size() > marker) {
+        auto [symbol, slot] = shadowed.back();
+        shadowed.pop_back();
+        bindings[symbol] = slot;
+    }
+}
+
+std::uint32_t SymbolTable::declare(Symbol symbol) {
+    if (symbol >= bindings.size())
+        bindings.resize(symbol + 1, None);
+    // Top-level bindings are never restored.
+    if (!markers.empty())
+        shadowed.emplace_back(symbol, bindings[symbol]);
+    return bindings[symbol] = declared++;
+}
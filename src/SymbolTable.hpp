@@ -0,0 +1,81 @@
+#ifndef TOYLANG_SYMBOLTABLE_HPP
+#define TOYLANG_SYMBOLTABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using Symbol = std::uint32_t;
+
+// Identifier names interned to dense ids as they are lexed, so that later
+// passes compare and index names as integers and never hash text again.
+// The table is flat and open-addressed (linear probing, power-of-two
+// capacity kept at most half full); each bucket holds a name's hash beside
+// its id, so a probe compares text only when the hashes match. Names are
+// views, usually into the source, and must outlive the interner, unless it
+// copies them.
+class SymbolInterner {
+  public:
+    // With copyNames each new name is copied, for an interner that outlives
+    // the sources it is fed, as the prompt's does.
+    explicit SymbolInterner(bool copyNames = false) : copyNames(copyNames) {}
+
+    Symbol intern(std::string_view name);
+
+    std::string_view name(Symbol symbol) const { return names[symbol]; }
+    std::uint32_t size() const { return names.size(); }
+
+  private:
+    static constexpr Symbol Empty = UINT32_MAX;
+
+    struct Bucket {
+        std::uint32_t hash = 0;
+        Symbol symbol = Empty;
+    };
+
+    std::vector<Bucket> buckets;
+    std::vector<std::string_view> names;
+    std::deque<std::string> copies; // stable addresses for names
+    bool copyNames;
+
+    void grow();
+};
+
+// Resolves each use of a name to the slot of its innermost declaration.
+// Every declaration gets a new slot, so one that shadows another never
+// overwrites it. Symbols are dense, so the current bindings sit in a flat
+// array indexed by symbol: an open-addressed table that never has to probe.
+// Declaring a name inside a scope saves the binding it shadows on a stack,
+// and scopes are markers into that stack; leaving one restores what its
+// declarations hid. Declaring and resolving are O(1).
+class SymbolTable {
+  public:
+    static constexpr std::uint32_t None = UINT32_MAX;
+
+    void enterScope() { markers.push_back(shadowed.size()); }
+    void exitScope();
+    // Scopes entered and not yet left; 0 at the top level.
+    std::size_t depth() const { return markers.size(); }
+
+    // Binds symbol to a new slot in the innermost scope and returns it.
+    std::uint32_t declare(Symbol symbol);
+    // The slot symbol resolves to, or None.
+    std::uint32_t lookup(Symbol symbol) const {
+        return symbol < bindings.size() ? bindings[symbol] : None;
+    }
+
+    // Slots handed out so far.
+    std::uint32_t slots() const { return declared; }
+
+  private:
+    std::vector<std::uint32_t> bindings;
+    std::vector<std::pair<Symbol, std::uint32_t>> shadowed;
+    std::vector<std::size_t> markers;
+    std::uint32_t declared = 0;
+};
+
+#endif
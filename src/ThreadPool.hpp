@@ -0,0 +1,59 @@
+#ifndef TOYLANG_THREADPOOL_HPP
+#define TOYLANG_THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with one task deque each. Tasks submitted from
+// outside are dealt round-robin; a task submitted by a worker goes to that
+// worker's own deque. Workers take their newest task first and, when out of
+// work, steal the oldest task of another worker, so uneven jobs (files of
+// very different sizes) still keep every thread busy.
+class ThreadPool {
+  public:
+    // threads == 0 picks one per hardware thread.
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished. Must not be called
+    // from one of the pool's own tasks.
+    void wait();
+
+    unsigned size() const { return workers.size(); }
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<unsigned> nextQueue = 0;
+
+    // Guards sleeping, pending and stopping; queued only grows under it.
+    std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable finished;
+    std::atomic<std::size_t> queued = 0;
+    std::size_t pending = 0;
+    bool stopping = false;
+
+    bool pop(unsigned worker, std::function<void()> &task);
+    bool steal(unsigned worker, std::function<void()> &task);
+    void work(unsigned worker);
+};
+
+#endif
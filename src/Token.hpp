@@ -1,12 +1,12 @@
 #ifndef TOYLANG_TOKEN_HPP
 #define TOYLANG_TOKEN_HPP
 
-#include <map>
-#include <memory>
-#include <ostream>
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
 
-enum class TokenType {
+enum class TokenType : std::uint8_t {
     // Single-character tokens.
     LEFT_PAREN,
     RIGHT_PAREN,
@@ -34,6 +34,7 @@ enum class TokenType {
     IDENTIFIER,
     STRING,
     NUMBER,
+    INTEGER,
 
     // Keywords.
     AND,
@@ -56,111 +57,60 @@ enum class TokenType {
     END_OF_FILE
 };
 
-class Literal {
-  public:
-    virtual ~Literal() = default;
-
-    virtual std::string toString() const = 0;
-
-    virtual TokenType getType() const = 0;
-};
-
-class StringLiteral : public Literal {
-  public:
-    StringLiteral(const std::string &value) : value(value) {}
-
-    std::string toString() const { return value; }
-
-    TokenType getType() const { return TokenType::STRING; }
-
-    std::string value;
-};
-
-class NumberLiteral : public Literal {
-  public:
-    NumberLiteral(double value) : value(value) {}
-
-    std::string toString() const { return std::to_string(value); }
-
-    TokenType getType() const { return TokenType::NUMBER; }
-
-    double value;
-};
-
-class BooleanLiteral : public Literal {
-  public:
-    BooleanLiteral(bool value) : value(value) {}
-
-    std::string toString() const { return value ? "true" : "false"; }
-
-    TokenType getType() const {
-        return value ? TokenType::TRUE : TokenType::FALSE;
-    }
-
-    bool value;
-};
-
-class NullLiteral : public Literal {
-  public:
-    std::string toString() const { return "null"; }
-
-    TokenType getType() const { return TokenType::NIL; }
-};
-
+// Token names, indexed by TokenType.
+constexpr std::string_view tokenTypeNames[] = {
+    "LEFT_PAREN", "RIGHT_PAREN", "LEFT_BRACE",  "RIGHT_BRACE",   "COMMA",
+    "DOT",        "MINUS",       "PLUS",        "SEMICOLON",     "SLASH",
+    "STAR",       "BANG",        "BANG_EQUAL",  "EQUAL",         "EQUAL_EQUAL",
+    "GREATER",    "GREATER_EQUAL", "LESS",      "LESS_EQUAL",    "IDENTIFIER",
+    "STRING",     "NUMBER",      "INTEGER",     "AND",           "CLASS",
+    "ELSE",       "FALSE",       "FUN",         "FOR",           "IF",
+    "NIL",        "OR",          "PRINT",       "RETURN",        "SUPER",
+    "THIS",       "TRUE",        "VAR",         "WHILE",         "END_OF_FILE"};
+
+// Source text of tokens whose spelling is fixed by their type; empty for
+// IDENTIFIER, STRING, NUMBER, INTEGER and END_OF_FILE.
+constexpr std::string_view tokenTypeSpellings[] = {
+    "(",     ")",      "{",     "}",      ",",     ".",      "-",
+    "+",     ";",      "/",     "*",      "!",     "!=",     "=",
+    "==",    ">",      ">=",    "<",      "<=",    "",       "",
+    "",      "",       "and",   "class",  "else",  "false",  "fun",
+    "for",   "if",     "null",  "or",     "print", "return", "super",
+    "this",  "true",   "var",   "while",  ""};
+
+static_assert(std::size(tokenTypeNames) ==
+                  static_cast<std::size_t>(TokenType::END_OF_FILE) + 1,
+              "tokenTypeNames is out of sync with TokenType");
+static_assert(std::size(tokenTypeSpellings) == std::size(tokenTypeNames),
+              "tokenTypeSpellings is out of sync with TokenType");
+
+constexpr std::string_view name(TokenType type) {
+    return tokenTypeNames[static_cast<std::size_t>(type)];
+}
+
+constexpr std::string_view spelling(TokenType type) {
+    return tokenTypeSpellings[static_cast<std::size_t>(type)];
+}
+
+// A token is 16 bytes and owns nothing: its type, where it sits in the
+// source and, for NUMBER, INTEGER and STRING, an index into the Lexer's
+// LiteralTable (for IDENTIFIER, its interned symbol).
+// Text and line are recovered on demand with Lexer::lexeme and Lexer::line.
+// (A std::string lexeme plus three ints took 48 bytes, and a heap block for
+// any lexeme longer than 15 bytes.)
 class Token {
   public:
-    Token(TokenType type, const std::string &lexeme, int pos, int len, int line)
-        : type(type), lexeme(lexeme), pos(pos), len(len), line(line) {}
-
-    std::string toString() const {
-        std::map<TokenType, std::string> tokens = {
-            {TokenType::LEFT_PAREN, "LEFT_PAREN"},
-            {TokenType::RIGHT_PAREN, "RIGHT_PAREN"},
-            {TokenType::LEFT_BRACE, "LEFT_BRACE"},
-            {TokenType::RIGHT_BRACE, "RIGHT_BRACE"},
-            {TokenType::COMMA, "COMMA"},
-            {TokenType::DOT, "DOT"},
-            {TokenType::MINUS, "MINUS"},
-            {TokenType::PLUS, "PLUS"},
-            {TokenType::SEMICOLON, "SEMICOLON"},
-            {TokenType::SLASH, "SLASH"},
-            {TokenType::STAR, "STAR"},
-            {TokenType::BANG, "BANG"},
-            {TokenType::BANG_EQUAL, "BANG_EQUAL"},
-            {TokenType::EQUAL, "EQUAL"},
-            {TokenType::EQUAL_EQUAL, "EQUAL_EQUAL"},
-            {TokenType::GREATER, "GREATER"},
-            {TokenType::GREATER_EQUAL, "GREATER_EQUAL"},
-            {TokenType::LESS, "LESS"},
-            {TokenType::LESS_EQUAL, "LESS_EQUAL"},
-            {TokenType::IDENTIFIER, "IDENTIFIER"},
-            {TokenType::STRING, "STRING"},
-            {TokenType::NUMBER, "NUMBER"},
-            {TokenType::AND, "AND"},
-            {TokenType::CLASS, "CLASS"},
-            {TokenType::ELSE, "ELSE"},
-            {TokenType::FALSE, "FALSE"},
-            {TokenType::FUN, "FUN"},
-            {TokenType::FOR, "FOR"},
-            {TokenType::IF, "IF"},
-            {TokenType::NIL, "NIL"},
-            {TokenType::OR, "OR"},
-            {TokenType::PRINT, "PRINT"},
-            {TokenType::RETURN, "RETURN"},
-            {TokenType::SUPER, "SUPER"},
-            {TokenType::THIS, "THIS"},
-            {TokenType::TRUE, "TRUE"},
-            {TokenType::VAR, "VAR"},
-            {TokenType::WHILE, "WHILE"},
-            {TokenType::END_OF_FILE, "END_OF_FILE"}};
-        return tokens[type] + " " + lexeme;
-    }
-
-    TokenType type;
-    std::string lexeme;
-    int pos;
-    int len;
-    int line;
+    Token() = default;
+    Token(TokenType type, std::uint32_t pos, std::uint32_t len,
+          std::uint32_t literal = 0)
+        : type(type), pos(pos), len(len), literal(literal) {}
+
+    TokenType type = TokenType::END_OF_FILE;
+    std::uint32_t pos = 0;     // offset of the first byte in the source
+    std::uint32_t len = 0;     // bytes in the source, quotes included
+    std::uint32_t literal = 0; // LiteralTable index or symbol
 };
 
-#endif
\ No newline at end of file
+static_assert(sizeof(Token) == 16, "tokens are meant to stay 16 bytes");
+
+#endif
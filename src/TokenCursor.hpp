@@ -0,0 +1,52 @@
+#ifndef TOYLANG_TOKENCURSOR_HPP
+#define TOYLANG_TOKENCURSOR_HPP
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+#include "Lexer.hpp"
+#include "Token.hpp"
+
+// Pulls tokens from a Lexer on demand and keeps only a small ring of them:
+// the previous token, the current one and a little lookahead. Parsing can
+// therefore start before lexing has finished, and memory stays bounded no
+// matter how long the token stream is.
+class TokenCursor {
+  public:
+    static constexpr std::size_t Capacity = 4;
+    static constexpr std::size_t MaxLookahead = Capacity - 2;
+
+    explicit TokenCursor(Lexer &lexer) : lexer(lexer) {
+        ring[0] = lexer.next();
+        filled = 1;
+    }
+
+    const Token &peek() const { return ring[current % Capacity]; }
+
+    const Token &previous() const { return ring[(current - 1) % Capacity]; }
+
+    // Token `distance` positions after the current one.
+    const Token &lookahead(std::size_t distance) {
+        assert(distance <= MaxLookahead);
+        while (filled <= current + distance)
+            fill();
+        return ring[(current + distance) % Capacity];
+    }
+
+    void advance() {
+        current++;
+        if (filled == current)
+            fill();
+    }
+
+  private:
+    Lexer &lexer;
+    std::array<Token, Capacity> ring;
+    std::size_t current = 0;
+    std::size_t filled = 0;
+
+    void fill() { ring[filled++ % Capacity] = lexer.next(); }
+};
+
+#endif
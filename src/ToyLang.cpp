@@ -1,89 +1,396 @@
 #include "ToyLang.hpp"
+#include "JIT.hpp"
+#include "Profile.hpp"
+#include "Repl.hpp"
+#include "VM.hpp"
+#include "SourceBuffer.hpp"
 
-bool ToyLang::hadError = false;
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/Format.h>
 
-int main(int argc, char const *argv[]) {
-    if (argc > 2)
-        std::cerr << "Usage: " << argv[0] << " [script]" << std::endl;
-    else if (argc == 2)
-        ToyLang::runFile(argv[1]);
-    else
-        ToyLang::runPrompt();
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <set>
 
-    return 0;
+Options ToyLang::options;
+
+using Clock = std::chrono::steady_clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+// Entry points are named after the script, so the objects of many scripts
+// can be linked into one program.
+static std::string entryPrefix(const std::string &path,
+                               std::set<std::string> &taken) {
+    std::string stem =
+        path == "-" ? "stdin" : std::filesystem::path(path).stem().string();
+    for (char &c : stem)
+        if (!std::isalnum(static_cast<unsigned char>(c)))
+            c = '_';
+
+    std::string prefix = "toy_" + stem;
+    for (unsigned n = 2; !taken.insert(prefix).second; n++)
+        prefix = "toy_" + stem + "_" + std::to_string(n);
+    return prefix;
 }
 
-void ToyLang::runFile(const char *path) {
-    std::ifstream file(path);
-    if (!file.is_open())
-        std::cerr << "Could not open file: " << path << std::endl;
+static std::string objectPath(const std::string &path) {
+    if (path == "-")
+        return "stdin.o";
+    return std::filesystem::path(path).replace_extension(".o").string();
+}
+
+void ToyLang::runFiles(const std::vector<std::string> &paths) {
+    std::vector<std::string> files;
+    for (const std::string &path : paths) {
+        std::error_code error;
+        if (path == "-" || !std::filesystem::is_directory(path, error)) {
+            files.push_back(path);
+            continue;
+        }
+
+        std::vector<std::string> found;
+        for (const auto &entry :
+             std::filesystem::recursive_directory_iterator(path, error))
+            if (entry.is_regular_file() && entry.path().extension() == ".toy")
+                found.push_back(entry.path().string());
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+
+    if (files.empty()) {
+        std::cerr << "No scripts found." << std::endl;
+        exit(66);
+    }
+
+    std::vector<std::unique_ptr<SourceBuffer>> buffers;
+    std::size_t largest = 0;
+    for (const std::string &file : files) {
+        auto buffer = SourceBuffer::fromFile(file.c_str());
+        if (buffer == nullptr) {
+            std::cerr << "Could not open file: " << file << std::endl;
+            exit(66);
+        }
+
+        // Token offsets are 32-bit.
+        if (buffer->view().size() > UINT32_MAX) {
+            std::cerr << "File too large (4 GiB limit): " << file << std::endl;
+            exit(66);
+        }
+
+        largest = std::max(largest, buffer->view().size());
+        buffers.push_back(std::move(buffer));
+    }
+
+    // A lone script keeps the REPL's entry names unless it becomes an
+    // object file.
+    bool named = files.size() > 1 || options.compileOnly;
+    std::set<std::string> taken;
+    std::vector<std::unique_ptr<Session>> sessions;
+    for (std::size_t i = 0; i < files.size(); i++)
+        sessions.push_back(std::make_unique<Session>(
+            buffers[i]->view(), options,
+            named ? entryPrefix(files[i], taken) : "toy_expr"));
+
+    Profile profile;
+    if (!options.profileUse.empty()) {
+        if (!profile.read(options.profileUse))
+            exit(66);
+        for (std::size_t i = 0; i < files.size(); i++)
+            sessions[i]->useProfile(profile.counters(
+                files[i], Profile::hash(buffers[i]->view())));
+    }
+
+    std::unique_ptr<ThreadPool> pool;
+    if (options.jobs != 1 &&
+        (files.size() > 1 || largest >= 4 * Lexer::DefaultChunkSize))
+        pool = std::make_unique<ThreadPool>(options.jobs);
+
+    std::unique_ptr<CompileCache> cache;
+    if (!options.cacheDir.empty())
+        cache = std::make_unique<CompileCache>(options.cacheDir,
+                                               options.cacheSize);
+
+    auto compileStart = Clock::now();
+    std::atomic<bool> emitFailed = false;
+    // Exiting is left to this thread, once no task is still running.
+    std::atomic<bool> noTarget = false;
+
+    if (sessions.size() == 1 || pool == nullptr) {
+        for (std::size_t i = 0; i < sessions.size(); i++) {
+            if (!sessions[i]->compile(pool.get(), cache.get()))
+                exit(64);
+            if (options.compileOnly && !options.link &&
+                !sessions[i]->hadError()) {
+                std::string output =
+                    files.size() == 1 && !options.output.empty()
+                        ? options.output
+                        : objectPath(files[i]);
+                if (!sessions[i]->emitObject(output))
+                    emitFailed = true;
+            }
+        }
+    } else {
+        // Each file is one task; a Session shares nothing mutable with the
+        // others, so the tasks need no locking of their own.
+        for (std::size_t i = 0; i < sessions.size(); i++) {
+            pool->submit([&, i] {
+                Session &session = *sessions[i];
+                if (!session.compile(nullptr, cache.get())) {
+                    noTarget = true;
+                    return;
+                }
+                if (options.compileOnly && !options.link &&
+                    !session.hadError() &&
+                    !session.emitObject(objectPath(files[i])))
+                    emitFailed = true;
+            });
+        }
+        pool->wait();
+        if (noTarget)
+            exit(64);
+    }
+
+    if (options.time && files.size() > 1)
+        llvm::errs() << llvm::format(
+            "compiled %zu files in %.3f ms with -j%u\n", files.size(),
+            Milliseconds(Clock::now() - compileStart).count(),
+            pool ? pool->size() : 1u);
 
-    std::stringstream buffer;
+    if (cache) {
+        cache->evict();
+        if (options.cacheStats)
+            llvm::errs() << llvm::format(
+                "cache: %llu hits, %llu misses, %llu stored, %llu evicted\n",
+                (unsigned long long)cache->hits(),
+                (unsigned long long)cache->misses(),
+                (unsigned long long)cache->stores(),
+                (unsigned long long)cache->evictions());
+    }
 
-    buffer << file.rdbuf();
-    file.close();
+    if (emitFailed)
+        exit(73);
 
-    run(buffer.str().c_str());
+    if (options.compileOnly && options.link && options.output.empty())
+        options.output = objectPath(files[0]);
 
-    if (ToyLang::hadError)
+    if (!finish(sessions, files, profile))
         exit(65);
 }
 
 void ToyLang::runPrompt() {
+    Repl repl(options, llvm::outs(), std::cerr);
     std::string line;
     while (true) {
-        std::cout << "\x1b[1;33m>>> \x1b[0m";
-        std::getline(std::cin, line);
-        if (line == "exit")
+        std::cout << "\x1b[1;33m>>> \x1b[0m" << std::flush;
+        if (!std::getline(std::cin, line) || line == "exit")
             return;
 
-        run(line.c_str());
-        ToyLang::hadError = false;
+        repl.eval(line);
     }
 }
 
-void ToyLang::run(const char *source) {
-    static std::vector<Token> allTokens;
-    Lexer lexer(source);
-    auto tokens = lexer.scanTokens();
+// Every Session's module lives in its own LLVMContext, and modules can only
+// be linked within one, so each is carried over through bitcode.
+static std::unique_ptr<llvm::Module>
+linkSessions(std::vector<std::unique_ptr<Session>> &sessions,
+             llvm::LLVMContext &context) {
+    auto linked = std::make_unique<llvm::Module>("toylang", context);
+    llvm::Linker linker(*linked);
+
+    for (auto &session : sessions) {
+        llvm::SmallVector<char, 0> bitcode;
+        llvm::raw_svector_ostream stream(bitcode);
+        llvm::WriteBitcodeToFile(session->compiler().module(), stream);
+        session->compiler().takeModule();
 
-    if (allTokens.empty())
-        allTokens = tokens;
-    else {
-        allTokens.pop_back();
-        allTokens.insert(allTokens.end(), tokens.begin(), tokens.end());
+        auto module = llvm::parseBitcodeFile(
+            llvm::MemoryBufferRef(llvm::StringRef(bitcode.data(),
+                                                  bitcode.size()),
+                                  "session"),
+            context);
+        if (!module) {
+            llvm::errs() << module.takeError() << '\n';
+            return nullptr;
+        }
+
+        if (linker.linkInModule(std::move(*module)))
+            return nullptr;
     }
+    return linked;
+}
 
-    // Parser<std::string> parser(allTokens);
-    // auto expr = parser.parse();
+bool ToyLang::finish(std::vector<std::unique_ptr<Session>> &sessions,
+                     const std::vector<std::string> &files,
+                     Profile &profile) {
+    // Objects for the cache are compiled ahead of the JIT, and count
+    // towards its time.
+    double codegenTime = 0, optimizeTime = 0, objectTime = 0;
+    for (auto &session : sessions) {
+        llvm::outs() << session->listing();
+        codegenTime += session->codegenSeconds();
+        optimizeTime += session->optimizeSeconds();
+        objectTime += session->objectSeconds();
+    }
 
-    // if (expr == nullptr)
-    //     return;
+    auto jitStart = Clock::now();
+    auto runStart = jitStart, runEnd = jitStart;
 
-    // StringifyAST stringifier;
-    // std::cout << stringifier.toString(expr) << std::endl;
+    // Without --link every session keeps its own module.
+    std::vector<llvm::orc::ThreadSafeModule> modules;
+    if (options.link) {
+        auto context = std::make_unique<llvm::LLVMContext>();
+        std::unique_ptr<llvm::Module> linked = linkSessions(sessions, *context);
+        if (linked == nullptr)
+            exit(70);
+        modules.emplace_back(std::move(linked), std::move(context));
+    }
 
-    Parser<llvm::Value *> parser(tokens);
-    auto expr = parser.parse();
+    bool hadError = false;
+    for (auto &session : sessions)
+        hadError |= session->hadError();
 
-    if (expr == nullptr)
-        return;
+    if (options.compileOnly) {
+        if (options.link && !hadError) {
+            ObjectEmitter emitter(options.triple, options.cpu);
+            if (!emitter.valid())
+                exit(64);
+            bool emitted = modules[0].withModuleDo([&](llvm::Module &module) {
+                emitter.prepare(module);
+                return emitter.emit(module, options.output);
+            });
+            if (!emitted)
+                exit(73);
+        }
+    } else if (options.vm) {
+        VM vm;
+        std::vector<const Chunk *> chunks;
+        for (auto &session : sessions)
+            for (const Chunk &chunk : session->bytecode())
+                chunks.push_back(&chunk);
 
-    Compiler compiler;
-    compiler.codegen(expr)->print(llvm::outs());
+        std::vector<Session::Result> results(chunks.size());
 
-    std::cout << std::endl;
-}
+        runStart = Clock::now();
+        for (std::size_t i = 0; i < chunks.size(); i++)
+            results[i] = vm.run(*chunks[i]);
+        runEnd = Clock::now();
+
+        for (std::size_t i = 0; i < chunks.size(); i++)
+            if (chunks[i]->type != ValueType::Unknown)
+                llvm::outs() << Session::format(chunks[i]->type, results[i])
+                             << '\n';
+    } else if (!options.emitLlvm) {
+        JIT jit;
+        for (auto &module : modules)
+            jit.add(std::move(module));
+        if (!options.link) {
+            for (auto &session : sessions) {
+                if (auto object = session->takeObject())
+                    jit.add(std::move(object));
+                else
+                    jit.add(session->compiler().takeModule());
+            }
+        }
+
+        // Looking the functions up is what compiles them.
+        std::vector<const Session::Entry *> entries;
+        std::vector<std::size_t> owners;
+        std::vector<void *> functions;
+        for (std::size_t i = 0; i < sessions.size(); i++) {
+            for (const Session::Entry &entry : sessions[i]->entries()) {
+                entries.push_back(&entry);
+                owners.push_back(i);
+                functions.push_back(jit.lookup<void>(entry.name));
+            }
+        }
+
+        std::vector<Session::Result> results(entries.size());
 
-void ToyLang::error(int line, std::string message) {
-    Logger::report(line, "", message);
-    ToyLang::hadError = true;
+        runStart = Clock::now();
+        for (std::size_t i = 0; i < entries.size(); i++)
+            results[i] = Session::call(*entries[i], functions[i]);
+        runEnd = Clock::now();
+
+        for (std::size_t i = 0; i < entries.size(); i++)
+            if (entries[i]->type != ValueType::Unknown)
+                llvm::outs() << Session::format(entries[i]->type, results[i])
+                             << '\n';
+
+        if (!options.profileGenerate.empty()) {
+            for (std::size_t i = 0; i < entries.size(); i++) {
+                const Session::Entry &entry = *entries[i];
+                std::uint64_t count =
+                    *jit.lookup<std::uint64_t>(entry.name + ".count");
+                const Session &session = *sessions[owners[i]];
+                profile.add(files[owners[i]],
+                            Profile::hash(session.sourceText()),
+                            {entry.statement, entry.line, entry.pos, count});
+            }
+        }
+    }
+
+    llvm::outs().flush();
+
+    if (options.time && options.vm) {
+        llvm::errs() << llvm::format("bytecode %.3f ms, run %.3f ms\n",
+                                     codegenTime * 1000,
+                                     Milliseconds(runEnd - runStart).count());
+    } else if (options.time) {
+        llvm::errs() << llvm::format(
+            "codegen %.3f ms, -O%u %.3f ms, jit %.3f ms, run %.3f ms\n",
+            codegenTime * 1000, options.optLevel, optimizeTime * 1000,
+            objectTime * 1000 + Milliseconds(runStart - jitStart).count(),
+            Milliseconds(runEnd - runStart).count());
+    }
+
+    if (!options.profileGenerate.empty() &&
+        !profile.write(options.profileGenerate))
+        exit(73);
+    if (options.profileReport)
+        report(sessions, files, profile);
+
+    Diagnostics diagnostics;
+    for (std::size_t i = 0; i < sessions.size(); i++)
+        diagnostics.absorb(sessions[i]->diagnostics(),
+                           sessions.size() > 1 ? files[i] : "");
+    diagnostics.flush(std::cerr, options.diagnostics);
+
+    return !hadError;
 }
 
-void ToyLang::error(Token token, std::string message) {
-    if (token.type == TokenType::END_OF_FILE)
-        Logger::report(token.line, " at end", message);
-    else
-        Logger::report(token.line, " at '" + token.lexeme + "'", message);
-    ToyLang::hadError = true;
+// The hottest statements of the profile with the source line each starts
+// on, e.g. "  1200  a.toy:3:5  x * 2 + 1".
+void ToyLang::report(std::vector<std::unique_ptr<Session>> &sessions,
+                     const std::vector<std::string> &files,
+                     const Profile &profile) {
+    llvm::errs() << "hot spots:\n";
+    for (const Profile::HotSpot &spot : profile.hottest(10)) {
+        auto file = std::find(files.begin(), files.end(), *spot.file);
+        std::string_view line;
+        std::uint32_t column = 0;
+        if (file != files.end()) {
+            std::string_view source =
+                sessions[file - files.begin()]->sourceText();
+            std::size_t start = source.rfind('\n', spot.counter.pos);
+            start = start == std::string_view::npos || spot.counter.pos == 0
+                        ? 0
+                        : start + 1;
+            column = spot.counter.pos - start + 1;
+            line = source.substr(start, source.find('\n', start) - start);
+            if (line.size() > 60)
+                line = line.substr(0, 60);
+        }
+        auto count = static_cast<unsigned long long>(spot.counter.count);
+        llvm::errs() << llvm::format("%10llu  ", count)
+                     << *spot.file << ':' << spot.counter.line;
+        if (column != 0)
+            llvm::errs() << ':' << column << "  " << line;
+        llvm::errs() << '\n';
+    }
 }
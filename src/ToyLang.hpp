@@ -1,32 +1,35 @@
 #ifndef TOYLANG_HPP
 #define TOYLANG_HPP
 
-#include "Compiler.hpp"
-#include "Lexer.hpp"
-#include "Logger.hpp"
-#include "Parser.hpp"
-#include "StringifyAST.hpp"
-#include "Token.hpp"
+#include "Options.hpp"
+#include "Profile.hpp"
+#include "Session.hpp"
 
-#include "llvm/IR/Value.h"
-
-#include <fstream>
-#include <iostream>
-#include <sstream>
+#include <memory>
 #include <string>
+#include <vector>
 
 class ToyLang {
   public:
-    static void runFile(const char *path);
-    static void runPrompt();
+    static Options options;
 
-    static void error(int line, std::string message);
-    static void error(Token token, std::string message);
+    // Compiles every script, each in its own Session and, given more than
+    // one, in parallel; a directory stands for the *.toy files under it.
+    // The scripts are then run, or written out as object files with -c, in
+    // the order given.
+    static void runFiles(const std::vector<std::string> &paths);
+    static void runPrompt();
 
   private:
-    static bool hadError;
-
-    static void run(const char *source);
+    // Runs (or emits) the compiled sessions of files, adds their counts to
+    // profile under --profile-generate, and prints their diagnostics; false
+    // if any session had an error.
+    static bool finish(std::vector<std::unique_ptr<Session>> &sessions,
+                       const std::vector<std::string> &files,
+                       Profile &profile);
+    static void report(std::vector<std::unique_ptr<Session>> &sessions,
+                       const std::vector<std::string> &files,
+                       const Profile &profile);
 };
 
-#endif
\ No newline at end of file
+#endif
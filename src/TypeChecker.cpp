@@ -0,0 +1,124 @@
+#include "TypeChecker.hpp"
+
+ValueType TypeChecker::check(const Expr *expr, ExprTypes &types) {
+    this->types = &types;
+    return expr->accept(*this);
+}
+
+ValueType TypeChecker::error(const Token &token, std::string message) {
+    lexer.error(token, std::move(message));
+    return ValueType::Unknown;
+}
+
+ValueType TypeChecker::visit(const BinaryExpr &expr, ValueType left,
+                             ValueType right) {
+    return types->set(expr, binary(expr.op, left, right));
+}
+
+ValueType TypeChecker::visit(const DeclarationExpr &expr,
+                             ValueType initializer) {
+    if (expr.slot >= variables.size())
+        variables.resize(expr.slot + 1, ValueType::Unknown);
+    variables[expr.slot] = initializer;
+    return types->set(expr, initializer);
+}
+
+ValueType TypeChecker::visit(const GroupingExpr &expr, ValueType expression) {
+    return types->set(expr, expression);
+}
+
+ValueType TypeChecker::visit(const LiteralExpr &expr) {
+    return types->set(expr, literal(expr.value));
+}
+
+ValueType TypeChecker::visit(const UnaryExpr &expr, ValueType right) {
+    return types->set(expr, unary(expr.op, right));
+}
+
+ValueType TypeChecker::visit(const VariableExpr &expr) {
+    ValueType type = expr.slot < variables.size() ? variables[expr.slot]
+                                                  : ValueType::Unknown;
+    if (type == ValueType::Unknown && expr.slot < inherited)
+        type = error(expr.name, "Use of invalid variable.");
+    return types->set(expr, type);
+}
+
+ValueType TypeChecker::binary(const Token &op, ValueType left,
+                              ValueType right) {
+    if (left == ValueType::Unknown || right == ValueType::Unknown)
+        return ValueType::Unknown;
+
+    if (op.type == TokenType::PLUS &&
+        (left == ValueType::String || right == ValueType::String)) {
+        if (left == ValueType::Null || right == ValueType::Null)
+            return error(op, "Invalid string concatenation.");
+        return ValueType::String;
+    }
+
+    if (op.type == TokenType::AND || op.type == TokenType::OR) {
+        if (left != ValueType::Bool || right != ValueType::Bool)
+            return error(op, "Operands must be booleans.");
+        return ValueType::Bool;
+    }
+
+    if (left == ValueType::Bool && right == ValueType::Bool &&
+        (op.type == TokenType::EQUAL_EQUAL ||
+         op.type == TokenType::BANG_EQUAL))
+        return ValueType::Bool;
+
+    if (!isNumeric(left) || !isNumeric(right))
+        return error(op, "Operands must be numbers.");
+
+    switch (op.type) {
+    case TokenType::PLUS:
+    case TokenType::MINUS:
+    case TokenType::STAR:
+    case TokenType::SLASH:
+        return arithmeticType(op.type, left, right);
+    case TokenType::GREATER:
+    case TokenType::GREATER_EQUAL:
+    case TokenType::LESS:
+    case TokenType::LESS_EQUAL:
+    case TokenType::EQUAL_EQUAL:
+    case TokenType::BANG_EQUAL:
+        return ValueType::Bool;
+    default:
+        return error(op, "Invalid binary operator.");
+    }
+}
+
+ValueType TypeChecker::literal(const Token &value) {
+    switch (value.type) {
+    case TokenType::NUMBER:
+        return ValueType::Number;
+    case TokenType::INTEGER:
+        return ValueType::Integer;
+    case TokenType::TRUE:
+    case TokenType::FALSE:
+        return ValueType::Bool;
+    case TokenType::STRING:
+        return ValueType::String;
+    case TokenType::NIL:
+        return ValueType::Null;
+    default:
+        return error(value, "Invalid literal.");
+    }
+}
+
+ValueType TypeChecker::unary(const Token &op, ValueType operand) {
+    if (operand == ValueType::Unknown)
+        return ValueType::Unknown;
+
+    switch (op.type) {
+    case TokenType::MINUS:
+        if (!isNumeric(operand))
+            return error(op, "Operand must be a number.");
+        return operand;
+    case TokenType::BANG:
+        if (operand != ValueType::Bool)
+            return error(op, "Operand must be a boolean.");
+        return ValueType::Bool;
+    default:
+        return error(op, "invalid unary operator.");
+    }
+}
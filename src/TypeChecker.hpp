@@ -0,0 +1,68 @@
+#ifndef TOYLANG_TYPECHECKER_HPP
+#define TOYLANG_TYPECHECKER_HPP
+
+#include "Expr.hpp"
+#include "Lexer.hpp"
+#include "Token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Infers the type of every node of a statement and records it in an
+// ExprTypes, reporting each operator applied to operands it does not take
+// at the operator's token. A + with a string on either side concatenates
+// (a number or a boolean is formatted into it); and, or and ! take
+// booleans; == and != take two numbers or two booleans; every other
+// operator takes numbers, promoting an integer to a double only when the
+// other side is one or the operator is /. null is a value of its own that
+// no operator takes. The code generators rely on the recorded types and
+// never check a type again, so a statement whose type is Unknown must not
+// be compiled.
+// An operand with an error makes its parent Unknown without a second
+// report. A variable has its initializer's type; statements must be checked
+// in order, so that every declaration is checked before its uses, and one
+// whose initializer has an error makes its uses Unknown. A use of such a
+// variable from an earlier source, whose error is long reported, is
+// reported itself.
+class TypeChecker : public ExprVisitor<ValueType> {
+  public:
+    // Slot types are kept in variables, if given, for sources that share
+    // their slots (see Parser); it must hold a type for every slot the
+    // earlier sources declared.
+    explicit TypeChecker(Lexer &lexer,
+                         std::vector<ValueType> *variables = nullptr)
+        : lexer(lexer),
+          variables(variables != nullptr ? *variables : ownVariables),
+          inherited(this->variables.size()) {}
+
+    // The type of the statement, Unknown if an error was reported; the
+    // type of each of its nodes goes into types.
+    ValueType check(const Expr *expr, ExprTypes &types);
+
+    ValueType visit(const BinaryExpr &expr, ValueType left,
+                    ValueType right) override;
+    ValueType visit(const DeclarationExpr &expr,
+                    ValueType initializer) override;
+    ValueType visit(const GroupingExpr &expr, ValueType expression) override;
+    ValueType visit(const LiteralExpr &expr) override;
+    ValueType visit(const UnaryExpr &expr, ValueType right) override;
+    ValueType visit(const VariableExpr &expr) override;
+
+  private:
+    Lexer &lexer;
+    ExprTypes *types = nullptr;
+    std::vector<ValueType> ownVariables;
+    // By slot.
+    std::vector<ValueType> &variables;
+    // Slots declared by earlier sources.
+    std::size_t inherited;
+
+    ValueType error(const Token &token, std::string message);
+    ValueType binary(const Token &op, ValueType left, ValueType right);
+    ValueType literal(const Token &value);
+    ValueType unary(const Token &op, ValueType operand);
+};
+
+#endif
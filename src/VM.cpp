@@ -0,0 +1,247 @@
+#include "VM.hpp"
+
+#include <cstring>
+#include <iterator>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TOYLANG_THREADED_DISPATCH
+#endif
+
+static std::int64_t wrap(std::uint64_t value) {
+    return static_cast<std::int64_t>(value);
+}
+
+Session::Result VM::run(const Chunk &chunk) {
+    if (stack.size() < chunk.maxStack)
+        stack.resize(chunk.maxStack);
+    if (variables.size() < chunk.variables)
+        variables.resize(chunk.variables);
+
+    const std::uint8_t *ip = chunk.code.data();
+    // One past the top of the stack.
+    Value *sp = stack.data();
+
+    auto operand = [&ip] {
+        std::uint32_t index;
+        std::memcpy(&index, ip, sizeof(index));
+        ip += sizeof(index);
+        return index;
+    };
+
+#ifdef TOYLANG_THREADED_DISPATCH
+    static const void *const labels[] = {
+        &&Number, &&Integer, &&True, &&False, &&Null, &&String,
+        &&GetVariable, &&SetVariable, &&Add, &&Subtract, &&Multiply, &&Divide,
+        &&Negate, &&AddInt, &&SubtractInt, &&MultiplyInt, &&NegateInt,
+        &&Greater, &&GreaterEqual, &&Less, &&LessEqual, &&Equal, &&NotEqual,
+        &&GreaterInt, &&GreaterEqualInt, &&LessInt, &&LessEqualInt,
+        &&EqualInt, &&NotEqualInt, &&EqualBool, &&NotEqualBool, &&And, &&Or,
+        &&Not, &&IntToNumber, &&NumberToString, &&IntToString,
+        &&BoolToString, &&Concat, &&Return,
+    };
+    static_assert(std::size(labels) ==
+                  static_cast<std::size_t>(OpCode::Return) + 1);
+#define DISPATCH() goto *labels[*ip++]
+#define CASE(name) name
+    DISPATCH();
+#else
+#define DISPATCH() goto dispatch
+#define CASE(name) case OpCode::name
+dispatch:
+    switch (static_cast<OpCode>(*ip++)) {
+#endif
+
+    CASE(Number):
+        sp++->number = chunk.numbers[operand()];
+        DISPATCH();
+    CASE(Integer):
+        sp++->integer = chunk.integers[operand()];
+        DISPATCH();
+    CASE(True):
+        sp++->boolean = true;
+        DISPATCH();
+    CASE(False):
+        sp++->boolean = false;
+        DISPATCH();
+    CASE(Null):
+        sp++->string = nullptr;
+        DISPATCH();
+    CASE(String): {
+        const std::string &string = chunk.strings[operand()];
+        sp++->string = toy_string_literal(string.data(), string.size());
+        DISPATCH();
+    }
+    CASE(GetVariable):
+        *sp++ = variables[operand()];
+        DISPATCH();
+    CASE(SetVariable):
+        variables[operand()] = sp[-1];
+        DISPATCH();
+
+    CASE(Add):
+        sp--;
+        sp[-1].number += sp->number;
+        DISPATCH();
+    CASE(Subtract):
+        sp--;
+        sp[-1].number -= sp->number;
+        DISPATCH();
+    CASE(Multiply):
+        sp--;
+        sp[-1].number *= sp->number;
+        DISPATCH();
+    CASE(Divide):
+        sp--;
+        sp[-1].number /= sp->number;
+        DISPATCH();
+    CASE(Negate):
+        sp[-1].number = -sp[-1].number;
+        DISPATCH();
+
+    // Integer arithmetic wraps like the i64 instructions Compiler emits.
+    CASE(AddInt):
+        sp--;
+        sp[-1].integer = wrap(std::uint64_t(sp[-1].integer) + sp->integer);
+        DISPATCH();
+    CASE(SubtractInt):
+        sp--;
+        sp[-1].integer = wrap(std::uint64_t(sp[-1].integer) - sp->integer);
+        DISPATCH();
+    CASE(MultiplyInt):
+        sp--;
+        sp[-1].integer = wrap(std::uint64_t(sp[-1].integer) * sp->integer);
+        DISPATCH();
+    CASE(NegateInt):
+        sp[-1].integer = wrap(0 - std::uint64_t(sp[-1].integer));
+        DISPATCH();
+
+    // Comparisons are unordered, like Compiler's: true if either side is
+    // NaN, which negating the opposite test gives for free.
+    CASE(Greater):
+        sp--;
+        sp[-1].boolean = !(sp[-1].number <= sp->number);
+        DISPATCH();
+    CASE(GreaterEqual):
+        sp--;
+        sp[-1].boolean = !(sp[-1].number < sp->number);
+        DISPATCH();
+    CASE(Less):
+        sp--;
+        sp[-1].boolean = !(sp[-1].number >= sp->number);
+        DISPATCH();
+    CASE(LessEqual):
+        sp--;
+        sp[-1].boolean = !(sp[-1].number > sp->number);
+        DISPATCH();
+    CASE(Equal):
+        sp--;
+        sp[-1].boolean =
+            !(sp[-1].number < sp->number || sp[-1].number > sp->number);
+        DISPATCH();
+    CASE(NotEqual):
+        sp--;
+        sp[-1].boolean = sp[-1].number != sp->number;
+        DISPATCH();
+
+    CASE(GreaterInt):
+        sp--;
+        sp[-1].boolean = sp[-1].integer > sp->integer;
+        DISPATCH();
+    CASE(GreaterEqualInt):
+        sp--;
+        sp[-1].boolean = sp[-1].integer >= sp->integer;
+        DISPATCH();
+    CASE(LessInt):
+        sp--;
+        sp[-1].boolean = sp[-1].integer < sp->integer;
+        DISPATCH();
+    CASE(LessEqualInt):
+        sp--;
+        sp[-1].boolean = sp[-1].integer <= sp->integer;
+        DISPATCH();
+    CASE(EqualInt):
+        sp--;
+        sp[-1].boolean = sp[-1].integer == sp->integer;
+        DISPATCH();
+    CASE(NotEqualInt):
+        sp--;
+        sp[-1].boolean = sp[-1].integer != sp->integer;
+        DISPATCH();
+
+    CASE(EqualBool):
+        sp--;
+        sp[-1].boolean = sp[-1].boolean == sp->boolean;
+        DISPATCH();
+    CASE(NotEqualBool):
+        sp--;
+        sp[-1].boolean = sp[-1].boolean != sp->boolean;
+        DISPATCH();
+    CASE(And):
+        sp--;
+        sp[-1].boolean = sp[-1].boolean && sp->boolean;
+        DISPATCH();
+    CASE(Or):
+        sp--;
+        sp[-1].boolean = sp[-1].boolean || sp->boolean;
+        DISPATCH();
+    CASE(Not):
+        sp[-1].boolean = !sp[-1].boolean;
+        DISPATCH();
+
+    CASE(IntToNumber): {
+        Value &value = sp[-1 - *ip++];
+        value.number = static_cast<double>(value.integer);
+        DISPATCH();
+    }
+
+    // Booleans concatenate as Compiler's sign-extended i1 does: -1 or 0.
+    CASE(NumberToString): {
+        Value &value = sp[-1 - *ip++];
+        value.string = toy_string_from_number(value.number);
+        DISPATCH();
+    }
+    CASE(IntToString): {
+        Value &value = sp[-1 - *ip++];
+        value.string = toy_string_from_integer(value.integer);
+        DISPATCH();
+    }
+    CASE(BoolToString): {
+        Value &value = sp[-1 - *ip++];
+        value.string = toy_string_from_bool(value.boolean);
+        DISPATCH();
+    }
+    CASE(Concat):
+        sp--;
+        sp[-1].string = toy_string_concat(sp[-1].string, sp->string);
+        DISPATCH();
+
+    CASE(Return): {
+        Session::Result result{};
+        const Value &value = sp[-1];
+        switch (chunk.type) {
+        case ValueType::Number:
+            result.number = value.number;
+            break;
+        case ValueType::Integer:
+            result.integer = value.integer;
+            break;
+        case ValueType::Bool:
+            result.boolean = value.boolean;
+            break;
+        case ValueType::Unknown:
+        case ValueType::Null:
+            break;
+        default:
+            result.string = toy_string_data(value.string);
+            break;
+        }
+        return result;
+    }
+
+#ifndef TOYLANG_THREADED_DISPATCH
+    }
+#endif
+#undef DISPATCH
+#undef CASE
+    return {};
+}
@@ -0,0 +1,35 @@
+#ifndef TOYLANG_VM_HPP
+#define TOYLANG_VM_HPP
+
+#include "Bytecode.hpp"
+#include "Runtime.hpp"
+#include "Session.hpp"
+
+#include <vector>
+
+// Interpreter for Chunks. With GCC or Clang every instruction ends in an
+// indirect jump to the next one's handler (computed goto), which predicts
+// far better than a single switch; other compilers get the switch.
+class VM {
+  public:
+    // Strings in the result stay valid until release().
+    Session::Result run(const Chunk &chunk);
+
+    // Frees the strings built so far, which come from the string runtime
+    // and so include those of compiled code run on this thread.
+    void release() { toy_string_release(); }
+
+  private:
+    union Value {
+        double number;
+        std::int64_t integer;
+        bool boolean;
+        ToyString *string;
+    };
+
+    std::vector<Value> stack;
+    // By slot; they outlive the chunk that declares them.
+    std::vector<Value> variables;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "ToyLang.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+
+static int usage(const char *program) {
+    std::cerr << "Usage: " << program << " [options] [script | dir | -]...\n"
+              << "  -j <jobs>     worker threads for many or large inputs\n"
+              << "  --dump-ast    print the parsed tree\n"
+              << "  --flat-ast    use the structure-of-arrays AST\n"
+              << "  --emit-llvm   print the generated IR instead of running it\n"
+              << "  --vm          interpret bytecode instead of using LLVM\n"
+              << "  --dump-bytecode\n"
+              << "                print the bytecode of each statement (--vm)\n"
+              << "  -O0 ... -O3   LLVM optimization level (default -O0)\n"
+              << "  --fast-math   allow reassociating floating-point math\n"
+              << "  -c            compile each script to a native object file\n"
+              << "  -o <file>     object file for one script or --link\n"
+              << "                (default: script.o)\n"
+              << "  --link        link all scripts into one module first\n"
+              << "  --target=<triple>\n"
+              << "                target triple for -c (default: host)\n"
+              << "  --mcpu=<cpu>  CPU for -c; 'native' uses the host's features\n"
+              << "  --time        report compile and run time\n"
+              << "  --rebalance   balance long + and * chains (reassociates)\n"
+              << "  --no-fold     skip constant folding before codegen\n"
+              << "  --hash-cons   share identical subexpressions\n"
+              << "  --cache       reuse compiled scripts from the user cache\n"
+              << "  --cache-dir=<dir>\n"
+              << "                reuse compiled scripts from dir\n"
+              << "  --cache-size=<MiB>\n"
+              << "                cache size limit (default 256)\n"
+              << "  --cache-stats report cache hits and misses\n"
+              << "  --profile-generate=<file>\n"
+              << "                count statement executions into file\n"
+              << "  --profile-use=<file>\n"
+              << "                optimize with the counts in file\n"
+              << "  --profile-report\n"
+              << "                print the most executed statements\n"
+              << "  --diagnostics=human|json\n"
+              << "                error output format\n";
+    return 64;
+}
+
+int main(int argc, char const *argv[]) {
+    std::vector<std::string> scripts;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            std::string_view value = argv[++i];
+            auto [end, error] = std::from_chars(
+                value.data(), value.data() + value.size(),
+                ToyLang::options.jobs);
+            if (error != std::errc() || end != value.data() + value.size())
+                return usage(argv[0]);
+        } else if (arg == "--dump-ast")
+            ToyLang::options.dumpAst = true;
+        else if (arg == "--flat-ast")
+            ToyLang::options.flatAst = true;
+        else if (arg == "--vm")
+            ToyLang::options.vm = true;
+        else if (arg == "--dump-bytecode")
+            ToyLang::options.vm = ToyLang::options.dumpBytecode = true;
+        else if (arg == "--emit-llvm")
+            ToyLang::options.emitLlvm = true;
+        else if (arg.size() == 3 && arg.starts_with("-O") && arg[2] >= '0' &&
+                 arg[2] <= '3')
+            ToyLang::options.optLevel = arg[2] - '0';
+        else if (arg == "--fast-math")
+            ToyLang::options.fastMath = true;
+        else if (arg == "-c")
+            ToyLang::options.compileOnly = true;
+        else if (arg == "--link")
+            ToyLang::options.link = true;
+        else if (arg == "-o" && i + 1 < argc)
+            ToyLang::options.output = argv[++i];
+        else if (arg.starts_with("--target="))
+            ToyLang::options.triple = arg.substr(9);
+        else if (arg.starts_with("--mcpu="))
+            ToyLang::options.cpu = arg.substr(7);
+        else if (arg == "--time")
+            ToyLang::options.time = true;
+        else if (arg == "--rebalance")
+            ToyLang::options.rebalance = true;
+        else if (arg == "--no-fold")
+            ToyLang::options.fold = false;
+        else if (arg == "--hash-cons")
+            ToyLang::options.hashCons = true;
+        else if (arg == "--cache")
+            ToyLang::options.cacheDir = CompileCache::defaultDirectory();
+        else if (arg.starts_with("--cache-dir="))
+            ToyLang::options.cacheDir = arg.substr(12);
+        else if (arg.starts_with("--cache-size="))
+            ToyLang::options.cacheSize =
+                std::strtoull(argv[i] + 13, nullptr, 10) << 20;
+        else if (arg == "--cache-stats")
+            ToyLang::options.cacheStats = true;
+        else if (arg.starts_with("--profile-generate="))
+            ToyLang::options.profileGenerate = arg.substr(19);
+        else if (arg.starts_with("--profile-use="))
+            ToyLang::options.profileUse = arg.substr(14);
+        else if (arg == "--profile-report")
+            ToyLang::options.profileReport = true;
+        else if (arg == "--diagnostics=human")
+            ToyLang::options.diagnostics = DiagnosticFormat::Human;
+        else if (arg == "--diagnostics=json")
+            ToyLang::options.diagnostics = DiagnosticFormat::Json;
+        else if (arg.starts_with("-") && arg != "-")
+            return usage(argv[0]);
+        else
+            scripts.emplace_back(arg);
+    }
+
+    // Several objects would all have to be written to the one -o file.
+    if (!ToyLang::options.output.empty() && !ToyLang::options.link &&
+        scripts.size() > 1)
+        return usage(argv[0]);
+
+    if (ToyLang::options.compileOnly && scripts.empty())
+        return usage(argv[0]);
+
+    // Counts are read back from the JIT after the run, which the prompt
+    // never finishes; the VM has no profile support.
+    if (!ToyLang::options.profileGenerate.empty() &&
+        (ToyLang::options.compileOnly || ToyLang::options.vm ||
+         ToyLang::options.emitLlvm || scripts.empty()))
+        return usage(argv[0]);
+
+    // The VM has no module to print, link or write out.
+    if (ToyLang::options.vm &&
+        (ToyLang::options.emitLlvm || ToyLang::options.compileOnly ||
+         ToyLang::options.link))
+        return usage(argv[0]);
+
+    if (!scripts.empty())
+        ToyLang::runFiles(scripts);
+    else
+        ToyLang::runPrompt();
+
+    return 0;
+}
@@ -1,7 +1,733 @@
 #include <gtest/gtest.h>
 
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "CompileCache.hpp"
+#include "ConstantFolder.hpp"
+#include "FlatAST.hpp"
+#include "JIT.hpp"
+#include "Lexer.hpp"
+#include "ObjectEmitter.hpp"
+#include "Parser.hpp"
+#include "Profile.hpp"
+#include "Rebalancer.hpp"
+#include "Repl.hpp"
+#include "Runtime.hpp"
+#include "Session.hpp"
+#include "StringifyAST.hpp"
+#include "SymbolTable.hpp"
+#include "ToyLang.hpp"
+#include "TypeChecker.hpp"
+#include "VM.hpp"
+
 TEST(ToyLang, Main)
 {
     EXPECT_STRNE("hello", "world");
     EXPECT_EQ(7 * 6, 42);
-}
\ No newline at end of file
+}
+
+TEST(Lexer, ScansEveryTokenClass)
+{
+    Lexer lexer("var x = (1.5 + y) >= 2 != !z; # note\n"
+                "/* a * b\n */ \"two\nlines\" or while_ // done\n"
+                "classy class");
+    auto tokens = lexer.scanTokens();
+
+    std::vector<TokenType> expected = {
+        TokenType::VAR,        TokenType::IDENTIFIER,  TokenType::EQUAL,
+        TokenType::LEFT_PAREN, TokenType::NUMBER,      TokenType::PLUS,
+        TokenType::IDENTIFIER, TokenType::RIGHT_PAREN, TokenType::GREATER_EQUAL,
+        TokenType::INTEGER,    TokenType::BANG_EQUAL,  TokenType::BANG,
+        TokenType::IDENTIFIER, TokenType::SEMICOLON,   TokenType::STRING,
+        TokenType::OR,         TokenType::IDENTIFIER,  TokenType::IDENTIFIER,
+        TokenType::CLASS,      TokenType::END_OF_FILE};
+    ASSERT_EQ(tokens.size(), expected.size());
+    for (std::size_t i = 0; i < tokens.size(); i++)
+        EXPECT_EQ(tokens[i].type, expected[i]) << "token " << i;
+
+    EXPECT_EQ(lexer.lexeme(tokens[4]), "1.5");
+    EXPECT_EQ(lexer.literals().number(tokens[4]), 1.5);
+    EXPECT_EQ(lexer.literals().integer(tokens[9]), 2);
+    EXPECT_EQ(lexer.lexeme(tokens[14]), "two\nlines");
+    EXPECT_EQ(lexer.literals().string(tokens[14]), "two\nlines");
+    EXPECT_EQ(lexer.line(tokens[14]), 3);
+    EXPECT_EQ(lexer.line(tokens[18]), 5);
+}
+
+TEST(Lexer, ParallelScanMatchesSerialScan)
+{
+    std::string source;
+    for (int i = 0; i < 200; i++) {
+        source += "x" + std::to_string(i) + " + " + std::to_string(i) +
+                  ".25 // c\n";
+        if (i % 7 == 0)
+            source += "\"a string\nthat spans\n\nthree newlines\" +\n";
+        if (i % 11 == 0)
+            source += "/* a comment\n with \"quotes\n and * stars */ \n";
+        if (i % 13 == 0)
+            source += "   \n\t\n";
+    }
+
+    Lexer serial(source);
+    auto expected = serial.scanTokens();
+
+    ThreadPool pool(4);
+    for (std::size_t chunkSize : {1, 7, 32, 100, 4096}) {
+        Lexer parallel(source);
+        auto tokens = parallel.scanTokens(pool, chunkSize);
+
+        ASSERT_EQ(tokens.size(), expected.size()) << "chunk " << chunkSize;
+        for (std::size_t i = 0; i < tokens.size(); i++) {
+            EXPECT_EQ(tokens[i].type, expected[i].type) << "token " << i;
+            EXPECT_EQ(tokens[i].pos, expected[i].pos) << "token " << i;
+            EXPECT_EQ(tokens[i].len, expected[i].len) << "token " << i;
+            EXPECT_EQ(tokens[i].literal, expected[i].literal) << "token " << i;
+            EXPECT_EQ(parallel.line(tokens[i]), serial.line(expected[i]));
+        }
+        EXPECT_EQ(parallel.literals().numberCount(),
+                  serial.literals().numberCount());
+        EXPECT_EQ(parallel.literals().stringCount(),
+                  serial.literals().stringCount());
+        EXPECT_EQ(parallel.literals().symbols().size(),
+                  serial.literals().symbols().size());
+    }
+}
+
+TEST(SymbolTable, ShadowsAndRestoresAcrossScopes)
+{
+    SymbolInterner interner;
+    std::vector<Symbol> symbols;
+    for (int i = 0; i < 1000; i++)
+        symbols.push_back(interner.intern("v" + std::to_string(i % 500)));
+    EXPECT_EQ(interner.size(), 500u);
+    EXPECT_EQ(symbols[0], 0u);
+    EXPECT_EQ(symbols[500], symbols[0]);
+    EXPECT_EQ(interner.name(symbols[499]), "v499");
+
+    SymbolTable table;
+    EXPECT_EQ(table.lookup(3), SymbolTable::None);
+    EXPECT_EQ(table.declare(3), 0u);
+    table.enterScope();
+    EXPECT_EQ(table.declare(3), 1u);
+    EXPECT_EQ(table.declare(7), 2u);
+    EXPECT_EQ(table.lookup(3), 1u);
+    table.enterScope();
+    EXPECT_EQ(table.declare(3), 3u);
+    EXPECT_EQ(table.depth(), 2u);
+    table.exitScope();
+    EXPECT_EQ(table.lookup(3), 1u);
+    table.exitScope();
+    EXPECT_EQ(table.lookup(3), 0u);
+    EXPECT_EQ(table.lookup(7), SymbolTable::None);
+    EXPECT_EQ(table.slots(), 4u);
+}
+
+TEST(FlatAST, PrintsLikeTheTree)
+{
+    Lexer lexer("-(1 + 2) * 3 >= !(4 / \"x\") == 5 - -6");
+    Arena arena;
+    Parser parser(lexer, arena);
+    std::vector<const Expr *> statements = parser.parse();
+    ASSERT_EQ(statements.size(), 1u);
+    const Expr *expr = statements.front();
+
+    StringifyAST stringifier(lexer);
+    FlatAST ast = FlatAST::flatten(expr);
+    EXPECT_EQ(stringifier.toString(ast), stringifier.toString(expr));
+    EXPECT_EQ(ast.kind(ast.root()), ExprKind::Binary);
+}
+
+TEST(Parser, ClimbsEveryPrecedenceLevel)
+{
+    Lexer lexer("true or false and 1 != 2 < 3 + 4 * -5 - 6 / 7");
+    Arena arena;
+    Parser parser(lexer, arena);
+    std::vector<const Expr *> statements = parser.parse();
+    ASSERT_EQ(statements.size(), 1u);
+    const Expr *expr = statements.front();
+
+    StringifyAST stringifier(lexer);
+    EXPECT_EQ(stringifier.toString(expr),
+              "(or TRUE true (and FALSE false (!= INTEGER 1 (< INTEGER 2 "
+              "(- (+ INTEGER 3 (* INTEGER 4 (- INTEGER 5))) "
+              "(/ INTEGER 6 INTEGER 7))))))");
+}
+
+TEST(Parser, NestsDeeperThanTheNativeStack)
+{
+    constexpr int depth = 1 << 20;
+    std::string source = std::string(depth, '(') + std::string(depth, '-') +
+                         "1" + std::string(depth, ')');
+    Lexer lexer(source);
+    Arena arena;
+    Parser parser(lexer, arena);
+    std::vector<const Expr *> statements = parser.parse();
+    ASSERT_EQ(statements.size(), 1u);
+    const Expr *expr = statements.front();
+
+    EXPECT_EQ(FlatAST::flatten(expr).size(), 2 * depth + 1);
+}
+
+TEST(Rebalancer, BalancesNumericChainsOnly)
+{
+    auto rebalanced = [](const char *source) {
+        Lexer lexer(source);
+        Arena arena;
+        Parser parser(lexer, arena);
+        const Expr *expr = Rebalancer(arena).rebalance(parser.parse().front());
+        return StringifyAST(lexer).toString(expr);
+    };
+
+    EXPECT_EQ(rebalanced("1 + 2 + 3 + 4 + 5"),
+              "(+ (+ (+ INTEGER 1 INTEGER 2) (+ INTEGER 3 INTEGER 4)) "
+              "INTEGER 5)");
+    EXPECT_EQ(rebalanced("1 + 2 - 3 * 4 * 5 * 6"),
+              "(- (+ INTEGER 1 INTEGER 2) "
+              "(* (* INTEGER 3 INTEGER 4) (* INTEGER 5 INTEGER 6)))");
+    EXPECT_EQ(rebalanced("1 + 2 + 3 + \"a\""),
+              "(+ (+ (+ INTEGER 1 INTEGER 2) INTEGER 3) STRING a)");
+}
+
+TEST(Rebalancer, KeepsHashConsedSubtreesShared)
+{
+    Lexer lexer("(1 + 2 + 3 + 4) * (1 + 2 + 3 + 4)");
+    Arena arena;
+    Parser parser(lexer, arena, true);
+    const Expr *expr = Rebalancer(arena).rebalance(parser.parse().front());
+
+    auto &product = static_cast<const BinaryExpr &>(*expr);
+    EXPECT_EQ(product.left, product.right);
+    EXPECT_TRUE(product.left->shared);
+    EXPECT_EQ(StringifyAST(lexer).toString(expr),
+              "(* (group (+ (+ INTEGER 1 INTEGER 2) (+ INTEGER 3 INTEGER 4))) "
+              "(group (+ (+ INTEGER 1 INTEGER 2) (+ INTEGER 3 INTEGER 4))))");
+}
+
+TEST(Parser, RecoversAtStatementBoundaries)
+{
+    Lexer lexer("1 + ; 2 * 3; (4; 5 6; 7");
+    Arena arena;
+    Parser parser(lexer, arena);
+    std::vector<const Expr *> statements = parser.parse();
+
+    StringifyAST stringifier(lexer);
+    ASSERT_EQ(statements.size(), 2u);
+    EXPECT_EQ(stringifier.toString(statements[0]), "(* INTEGER 2 INTEGER 3)");
+    EXPECT_EQ(stringifier.toString(statements[1]), "INTEGER 7");
+
+    std::ostringstream out;
+    lexer.diagnostics().flush(out, DiagnosticFormat::Json);
+    EXPECT_EQ(out.str(),
+              "[{\"line\":1,\"pos\":4,\"len\":1,"
+              "\"message\":\"Expect expression.\"},"
+              "{\"line\":1,\"pos\":15,\"len\":1,"
+              "\"message\":\"Expect ')' after expression.\"},"
+              "{\"line\":1,\"pos\":19,\"len\":1,"
+              "\"message\":\"Expect ';' after expression.\"}]\n");
+    EXPECT_TRUE(lexer.diagnostics().empty());
+}
+
+TEST(Parser, ResolvesNamesThroughScopes)
+{
+    Lexer lexer("var a = 1; { var a = a + 1; a * 2 } a; b; var c = 1 +; "
+                "c; var d; { d");
+    Arena arena;
+    Parser parser(lexer, arena);
+    std::vector<const Expr *> statements = parser.parse();
+
+    StringifyAST stringifier(lexer);
+    ASSERT_EQ(statements.size(), 7u);
+    EXPECT_EQ(stringifier.toString(statements[0]), "(var a INTEGER 1)");
+    EXPECT_EQ(stringifier.toString(statements[1]),
+              "(var a (+ a INTEGER 1))");
+    EXPECT_EQ(stringifier.toString(statements[5]), "(var d NIL null)");
+
+    auto slot = [](const Expr *expr) {
+        return static_cast<const VariableExpr &>(*expr).slot;
+    };
+    auto &inner = static_cast<const DeclarationExpr &>(*statements[1]);
+    EXPECT_EQ(slot(static_cast<const BinaryExpr &>(*inner.initializer).left),
+              0u);
+    EXPECT_EQ(inner.slot, 1u);
+    EXPECT_EQ(slot(static_cast<const BinaryExpr &>(*statements[2]).left),
+              1u);
+    EXPECT_EQ(slot(statements[3]), 0u);
+    EXPECT_EQ(slot(statements[4]), 2u);
+    EXPECT_EQ(slot(statements[6]), 3u);
+
+    // c is declared although its initializer is not, so its use parses.
+    std::ostringstream out;
+    lexer.diagnostics().flush(out, DiagnosticFormat::Human);
+    EXPECT_EQ(out.str(), "[line 1] Error at 'b': Undefined variable.\n"
+                         "[line 1] Error at ';': Expect expression.\n"
+                         "[line 1] Error at end: Expect '}' after block.\n");
+}
+
+TEST(Parser, HashConsesIdenticalSubtrees)
+{
+    const char *source = "(1 + 2) * (1 + 2) - (1 + 2)";
+    Lexer lexer(source);
+    Arena arena;
+    Parser parser(lexer, arena, true);
+    const Expr *expr = parser.parse().front();
+
+    auto &root = static_cast<const BinaryExpr &>(*expr);
+    auto &product = static_cast<const BinaryExpr &>(*root.left);
+    EXPECT_EQ(product.left, product.right);
+    EXPECT_EQ(product.left, root.right);
+    EXPECT_EQ(parser.nodes().nodes(), 6u);
+
+    Lexer treeLexer(source);
+    Arena treeArena;
+    Parser treeParser(treeLexer, treeArena);
+    EXPECT_EQ(StringifyAST(lexer).toString(expr),
+              StringifyAST(treeLexer).toString(treeParser.parse().front()));
+}
+
+TEST(ConstantFolder, FoldsLikeCodegen)
+{
+    auto folded = [](const char *source) {
+        Lexer lexer(source);
+        Arena arena;
+        Parser parser(lexer, arena);
+        const Expr *expr =
+            ConstantFolder(lexer, arena).fold(parser.parse().front());
+        return StringifyAST(lexer).toString(expr);
+    };
+
+    EXPECT_EQ(folded("(1 + 2) * 3 - 4 / 8"), "NUMBER 8.5");
+    EXPECT_EQ(folded("9007199254740993 * 1 - -1 < 2 * 3"), "FALSE false");
+    EXPECT_EQ(folded("9007199254740993 + 1"), "INTEGER 9007199254740994");
+    EXPECT_EQ(folded("9223372036854775807 + 1"),
+              "INTEGER -9223372036854775808");
+    EXPECT_EQ(folded("\"a\" + 1.5 + true"), "STRING a1.5-1");
+    EXPECT_EQ(folded("(0 / 0) == (0 / 0)"), "TRUE true");
+    EXPECT_EQ(folded("!(1 < 2) or true and !false"), "TRUE true");
+    EXPECT_EQ(folded("-true + (1 + 1)"), "(+ (- TRUE true) INTEGER 2)");
+}
+
+TEST(TypeChecker, AnnotatesEveryNodeAndReportsMismatches)
+{
+    Lexer lexer("(1 < 2) == !false; \"a\" + 1; null; 1 + (true - 2); "
+                "\"b\" + null; \"c\" == \"c\"; \"d\" and true");
+    Arena arena;
+    Parser parser(lexer, arena);
+    std::vector<const Expr *> statements = parser.parse();
+    ASSERT_EQ(statements.size(), 7u);
+
+    TypeChecker checker(lexer);
+    ExprTypes types;
+    EXPECT_EQ(checker.check(statements[0], types), ValueType::Bool);
+    auto &equality = static_cast<const BinaryExpr &>(*statements[0]);
+    EXPECT_EQ(types[equality.left], ValueType::Bool);
+    EXPECT_EQ(types[static_cast<const GroupingExpr &>(*equality.left)
+                        .expression],
+              ValueType::Bool);
+    EXPECT_EQ(checker.check(statements[1], types), ValueType::String);
+    EXPECT_EQ(checker.check(statements[2], types), ValueType::Null);
+
+    EXPECT_EQ(checker.check(statements[3], types), ValueType::Unknown);
+    EXPECT_EQ(types[static_cast<const BinaryExpr &>(*statements[3]).left],
+              ValueType::Integer);
+    EXPECT_EQ(checker.check(statements[4], types), ValueType::Unknown);
+    ASSERT_EQ(lexer.diagnostics().size(), 2u);
+    EXPECT_EQ(lexer.diagnostics()[0].message, "Operands must be numbers.");
+    EXPECT_EQ(lexer.diagnostics()[0].pos, 44u);
+    EXPECT_EQ(lexer.diagnostics()[1].message,
+              "Invalid string concatenation.");
+
+    // Only + takes strings, and the folder leaves the rest to be reported.
+    ConstantFolder folder(lexer, arena);
+    EXPECT_EQ(checker.check(folder.fold(statements[5]), types),
+              ValueType::Unknown);
+    EXPECT_EQ(checker.check(folder.fold(statements[6]), types),
+              ValueType::Unknown);
+    ASSERT_EQ(lexer.diagnostics().size(), 4u);
+    EXPECT_EQ(lexer.diagnostics()[2].message, "Operands must be numbers.");
+    EXPECT_EQ(lexer.diagnostics()[2].pos, 66u);
+    EXPECT_EQ(lexer.diagnostics()[3].message, "Operands must be booleans.");
+}
+
+TEST(Compiler, RunsThroughTheJIT)
+{
+    Lexer lexer("(1 + 2) * 3.5 >= 10; \"a\" + 1");
+    Arena arena;
+    Parser parser(lexer, arena);
+    std::vector<const Expr *> statements = parser.parse();
+    ASSERT_EQ(statements.size(), 2u);
+
+    TypeChecker checker(lexer);
+    Compiler compiler(lexer);
+    ExprTypes types;
+    for (std::size_t i = 0; i < statements.size(); i++) {
+        ValueType type = checker.check(statements[i], types);
+        compiler.begin();
+        ASSERT_NE(compiler.finish("test_" + std::to_string(i), type,
+                                  compiler.codegen(statements[i], types)),
+                  nullptr);
+    }
+
+    JIT jit;
+    jit.add(compiler.takeModule());
+    EXPECT_TRUE(jit.lookup<bool()>("test_0")());
+    EXPECT_STREQ(jit.lookup<const char *()>("test_1")(), "a1");
+}
+
+TEST(ObjectEmitter, WritesAHostObjectFile)
+{
+    Lexer lexer("1 + 2");
+    Arena arena;
+    Parser parser(lexer, arena);
+    const Expr *expr = parser.parse().front();
+
+    ObjectEmitter emitter("", "native");
+    ASSERT_TRUE(emitter.valid());
+
+    ExprTypes types;
+    ValueType type = TypeChecker(lexer).check(expr, types);
+    Compiler compiler(lexer);
+    emitter.prepare(compiler.module());
+    compiler.begin();
+    ASSERT_NE(
+        compiler.finish("toy_test_0", type, compiler.codegen(expr, types)),
+        nullptr);
+
+    std::string path = testing::TempDir() + "toy_test.o";
+    EXPECT_TRUE(emitter.emit(compiler.module(), path));
+
+    std::ifstream object(path, std::ios::binary);
+    char magic[4] = {};
+    object.read(magic, sizeof(magic));
+    EXPECT_EQ(std::string_view(magic + 1, 3), "ELF");
+}
+
+TEST(Session, CompilesSourcesOnManyThreads)
+{
+    Options options;
+    std::vector<std::string> sources;
+    std::vector<std::unique_ptr<Session>> sessions;
+    for (int i = 0; i < 8; i++)
+        sources.push_back(std::to_string(i) + " * 2; \"s\" + " +
+                          std::to_string(i) + "; 1 +;");
+    for (int i = 0; i < 8; i++)
+        sessions.push_back(std::make_unique<Session>(
+            sources[i], options, "toy_" + std::to_string(i)));
+
+    ThreadPool pool(4);
+    for (auto &session : sessions)
+        pool.submit([&session] { session->compile(); });
+    pool.wait();
+
+    JIT jit;
+    for (int i = 0; i < 8; i++) {
+        EXPECT_EQ(sessions[i]->diagnostics().size(), 1u);
+        ASSERT_EQ(sessions[i]->entries().size(), 2u);
+        jit.add(sessions[i]->compiler().takeModule());
+    }
+    for (int i = 0; i < 8; i++) {
+        std::string prefix = "toy_" + std::to_string(i);
+        EXPECT_EQ(jit.lookup<std::int64_t()>(prefix + "_0")(), i * 2);
+        EXPECT_EQ(jit.lookup<const char *()>(prefix + "_1")(),
+                  "s" + std::to_string(i));
+    }
+}
+
+TEST(CompileCache, SkipsTheFrontEndOnAWarmStart)
+{
+    std::string directory = testing::TempDir() + "toy_cache";
+    std::filesystem::remove_all(directory);
+    CompileCache cache(directory, 1 << 20);
+
+    Options options;
+    const char *source = "1 + 2; \"a\" + true";
+    Session cold(source, options, "toy_c");
+    cold.compile(nullptr, &cache);
+    EXPECT_FALSE(cold.cached());
+    EXPECT_EQ(cache.misses(), 1u);
+    EXPECT_EQ(cache.stores(), 1u);
+
+    Session warm(source, options, "toy_c");
+    warm.compile(nullptr, &cache);
+    EXPECT_TRUE(warm.cached());
+    EXPECT_EQ(cache.hits(), 1u);
+    ASSERT_EQ(warm.entries().size(), 2u);
+    EXPECT_EQ(warm.entries()[1].type, ValueType::String);
+
+    JIT jit;
+    jit.add(warm.takeObject());
+    EXPECT_EQ(jit.lookup<std::int64_t()>("toy_c_0")(), 3);
+    EXPECT_STREQ(jit.lookup<const char *()>("toy_c_1")(), "a-1");
+
+    ObjectEmitter host("", "native"), generic("", "");
+    llvm::TargetMachine &machine = host.targetMachine();
+    EXPECT_NE(CompileCache::key(source, Options(), "toy_c", machine),
+              CompileCache::key(source, Options(), "toy_c",
+                                generic.targetMachine()));
+    options.optLevel = 2;
+    EXPECT_NE(CompileCache::key(source, options, "toy_c", machine),
+              CompileCache::key(source, Options(), "toy_c", machine));
+
+    // A crashed store's temporary goes; one still being written stays.
+    std::string stale = directory + "/stale.tmp", fresh = directory + "/a.tmp";
+    std::ofstream(stale) << "partial";
+    std::ofstream(fresh) << "partial";
+    std::filesystem::last_write_time(
+        stale, std::filesystem::file_time_type::clock::now() -
+                   std::chrono::hours(2));
+
+    CompileCache tiny(directory, 0);
+    tiny.evict();
+    EXPECT_EQ(tiny.evictions(), 1u);
+    EXPECT_FALSE(std::filesystem::exists(stale));
+    EXPECT_TRUE(std::filesystem::exists(fresh));
+}
+
+TEST(Profile, CountsRunsAndFeedsThemBack)
+{
+    Options options;
+    options.profileGenerate = "unused";
+    const char *source = "1 + 2;\n  \"a\" + 3";
+    Session instrumented(source, options, "toy_p");
+    instrumented.compile();
+    ASSERT_EQ(instrumented.entries().size(), 2u);
+    EXPECT_EQ(instrumented.entries()[1].line, 2u);
+    EXPECT_EQ(instrumented.entries()[1].pos, 9u);
+
+    JIT jit;
+    jit.add(instrumented.compiler().takeModule());
+    for (int i = 0; i < 5; i++)
+        jit.lookup<std::int64_t()>("toy_p_0")();
+    jit.lookup<const char *()>("toy_p_1")();
+
+    Profile profile;
+    std::uint64_t hash = Profile::hash(source);
+    for (const Session::Entry &entry : instrumented.entries())
+        profile.add("p.toy", hash,
+                    {entry.statement, entry.line, entry.pos,
+                     *jit.lookup<std::uint64_t>(entry.name + ".count")});
+    std::string path = testing::TempDir() + "toy.prof";
+    std::filesystem::remove(path);
+    ASSERT_TRUE(profile.write(path));
+    ASSERT_TRUE(profile.write(path));
+
+    Profile merged;
+    ASSERT_TRUE(merged.read(path));
+    EXPECT_EQ(merged.counters("p.toy", hash + 1), nullptr);
+    const Profile::Counters *counters = merged.counters("p.toy", hash);
+    ASSERT_NE(counters, nullptr);
+    EXPECT_EQ(counters->at(0).count, 10u);
+    EXPECT_EQ(merged.hottest(1)[0].counter.statement, 0u);
+
+    Session optimized(source, Options(), "toy_q");
+    optimized.useProfile(counters);
+    optimized.compile();
+    llvm::Module &module = optimized.compiler().module();
+    EXPECT_NE(module.getProfileSummary(false), nullptr);
+    EXPECT_EQ(module.getFunction("toy_q_0")->getEntryCount()->getCount(),
+              10u);
+    EXPECT_TRUE(module.getFunction("toy_q_0")->hasFnAttribute(
+        llvm::Attribute::Hot));
+
+    Profile::Counters uniform = *counters;
+    for (auto &[statement, counter] : uniform)
+        counter.count = 1;
+    Session flat(source, Options(), "toy_u");
+    flat.useProfile(&uniform);
+    flat.compile();
+    llvm::Module &unranked = flat.compiler().module();
+    EXPECT_EQ(unranked.getProfileSummary(false), nullptr);
+    EXPECT_FALSE(unranked.getFunction("toy_u_0")->hasFnAttribute(
+        llvm::Attribute::Hot));
+}
+
+TEST(Repl, ReleasesEachLineOnceItIsPrinted)
+{
+    Options options;
+    std::string printed;
+    llvm::raw_string_ostream out(printed);
+    std::ostringstream errors;
+    Repl repl(options, out, errors);
+
+    EXPECT_TRUE(repl.eval("1 + 2; \"a\" + 1"));
+    EXPECT_FALSE(repl.eval("(1"));
+    for (int i = 0; i < 200; i++)
+        EXPECT_TRUE(repl.eval("!false"));
+    EXPECT_TRUE(repl.eval("2 * 3"));
+
+    EXPECT_EQ(repl.lines(), 203u);
+    EXPECT_TRUE(out.str().starts_with("3\na1\ntrue\n"));
+    EXPECT_TRUE(out.str().ends_with("true\n6\n"));
+    EXPECT_EQ(errors.str(),
+              "[line 1] Error at end: Expect ')' after expression.\n");
+}
+
+TEST(Repl, KeepsVariablesAcrossLines)
+{
+    for (bool vm : {false, true}) {
+        Options options;
+        options.vm = vm;
+        std::string printed;
+        llvm::raw_string_ostream out(printed);
+        std::ostringstream errors;
+        Repl repl(options, out, errors);
+
+        EXPECT_TRUE(repl.eval("var x = 4; var s = \"x=\" + x"));
+        EXPECT_TRUE(repl.eval("x + 1"));
+        EXPECT_TRUE(repl.eval("{ var x = 0.5; s + x; }"));
+        EXPECT_FALSE(repl.eval("{ var y = 1;"));
+        EXPECT_FALSE(repl.eval("y"));
+        EXPECT_TRUE(repl.eval("s + x"));
+
+        EXPECT_EQ(out.str(), "5\nx=40.5\nx=44\n");
+        EXPECT_EQ(errors.str(),
+                  "[line 1] Error at end: Expect '}' after block.\n"
+                  "[line 1] Error at 'y': Undefined variable.\n");
+    }
+}
+
+TEST(Repl, ReportsUsesOfVariablesWhoseDeclarationFailed)
+{
+    for (bool vm : {false, true}) {
+        Options options;
+        options.vm = vm;
+        std::string printed;
+        llvm::raw_string_ostream out(printed);
+        std::ostringstream errors;
+        Repl repl(options, out, errors);
+
+        EXPECT_FALSE(repl.eval("var z = 1 - \"a\"; z"));
+        EXPECT_FALSE(repl.eval("var q = ;"));
+        EXPECT_FALSE(repl.eval("z + 1"));
+        EXPECT_FALSE(repl.eval("q"));
+        EXPECT_TRUE(repl.eval("var z = 2; z"));
+
+        EXPECT_EQ(out.str(), "2\n");
+        EXPECT_EQ(errors.str(),
+                  "[line 1] Error at '-': Operands must be numbers.\n"
+                  "[line 1] Error at ';': Expect expression.\n"
+                  "[line 1] Error at 'z': Use of invalid variable.\n"
+                  "[line 1] Error at 'q': Use of invalid variable.\n");
+    }
+}
+
+TEST(VM, AgreesWithTheJIT)
+{
+    const char *source = "(1 + 2) * 3.5 >= 10; \"a\" + 1 / 3 + (0 < 1); "
+                         "-(0 / 0) != 1 and !false; 1 + \"b\"; true < 1; "
+                         "9223372036854775807 * 3 - -7 / 2 + \"i\" + 2 * 3";
+    Options options;
+    options.fold = false;
+    Session jitted(source, options, "toy_vm");
+    jitted.compile();
+    options.vm = true;
+    Session interpreted(source, options, "toy_vm");
+    interpreted.compile();
+
+    EXPECT_EQ(interpreted.diagnostics().size(), 1u);
+    EXPECT_EQ(interpreted.diagnostics()[0].message,
+              jitted.diagnostics()[0].message);
+    ASSERT_EQ(interpreted.bytecode().size(), 5u);
+    ASSERT_EQ(jitted.entries().size(), 5u);
+
+    JIT jit;
+    jit.add(jitted.compiler().takeModule());
+    VM vm;
+    for (std::size_t i = 0; i < 5; i++) {
+        const Session::Entry &entry = jitted.entries()[i];
+        const Chunk &chunk = interpreted.bytecode()[i];
+        EXPECT_EQ(chunk.type, entry.type);
+        EXPECT_EQ(Session::format(chunk.type, vm.run(chunk)),
+                  Session::format(entry.type,
+                                  Session::call(entry, jit.lookup<void>(
+                                                           entry.name))));
+    }
+}
+
+TEST(VM, KeepsVariablesBetweenStatements)
+{
+    const char *source = "var n = 2; var s = \"n=\" + n; { var n = 0.5; "
+                         "var t; t; s + n; } -n * n; var b = n > 1; "
+                         "!b or false; s";
+    Options options;
+    Session jitted(source, options, "toy_var");
+    jitted.compile();
+    options.vm = true;
+    Session interpreted(source, options, "toy_var");
+    interpreted.compile();
+    EXPECT_FALSE(interpreted.hadError());
+    ASSERT_EQ(jitted.entries().size(), 10u);
+    ASSERT_EQ(interpreted.bytecode().size(), 10u);
+
+    JIT jit;
+    jit.add(jitted.compiler().takeModule());
+    VM vm;
+    std::vector<std::string> fromJit, fromVm;
+    for (const Session::Entry &entry : jitted.entries()) {
+        Session::Result result =
+            Session::call(entry, jit.lookup<void>(entry.name));
+        if (entry.type != ValueType::Unknown)
+            fromJit.push_back(Session::format(entry.type, result));
+    }
+    for (const Chunk &chunk : interpreted.bytecode()) {
+        Session::Result result = vm.run(chunk);
+        if (chunk.type != ValueType::Unknown)
+            fromVm.push_back(Session::format(chunk.type, result));
+    }
+    EXPECT_EQ(fromJit, (std::vector<std::string>{"null", "n=20.5", "-4",
+                                                  "false", "n=2"}));
+    EXPECT_EQ(fromVm, fromJit);
+    vm.release();
+}
+
+TEST(Runtime, BuildsRopesAndFlattensThemOnce)
+{
+    ToyString *a = toy_string_literal("abc", 3);
+    EXPECT_EQ(toy_string_literal("abc", 3), a);
+    EXPECT_EQ(a->kind(), ToyString::Kind::Small);
+    EXPECT_EQ(toy_string_from_bool(true)->view(), "-1");
+    EXPECT_EQ(toy_string_from_integer(-42)->view(), "-42");
+    EXPECT_EQ(toy_string_from_number(0.25)->view(), "0.25");
+
+    std::string expected;
+    ToyString *built = toy_string_literal("", 0);
+    for (int i = 0; i < 10000; i++) {
+        ToyString *piece = i % 2 ? a : toy_string_from_integer(i);
+        built = toy_string_concat(built, piece);
+        expected += i % 2 ? "abc" : std::to_string(i);
+    }
+    EXPECT_EQ(built->kind(), ToyString::Kind::Rope);
+    EXPECT_EQ(built->size(), expected.size());
+    EXPECT_EQ(toy_string_data(built), expected);
+    EXPECT_EQ(built->kind(), ToyString::Kind::Flat);
+    toy_string_release();
+}
+
+TEST(Runtime, ConcatenatesPastTheConstantLimitAtRunTime)
+{
+    std::string source = "\"\"";
+    for (std::size_t i = 0; i < ConstantStringLimit / 4; i++)
+        source += " + \"ab\" + " + std::to_string(i % 10);
+    Options options;
+    Session jitted(source, options, "toy_rope");
+    jitted.compile();
+    options.vm = true;
+    Session interpreted(source, options, "toy_rope");
+    interpreted.compile();
+    ASSERT_EQ(jitted.entries().size(), 1u);
+    ASSERT_EQ(interpreted.bytecode().size(), 1u);
+
+    JIT jit;
+    jit.add(jitted.compiler().takeModule());
+    const Session::Entry &entry = jitted.entries()[0];
+    std::string text = Session::format(
+        entry.type, Session::call(entry, jit.lookup<void>(entry.name)));
+    EXPECT_EQ(text.size(), ConstantStringLimit / 4 * 3);
+    EXPECT_EQ(text.substr(0, 9), "ab0ab1ab2");
+    VM vm;
+    EXPECT_EQ(Session::format(ValueType::String,
+                              vm.run(interpreted.bytecode()[0])),
+              text);
+    toy_string_release();
+}